@@ -0,0 +1,191 @@
+#include "auditlog.h"
+#include <QDir>
+#include <QDateTime>
+#include <QDebug>
+#include <chrono>
+
+AuditLog& AuditLog::instance()
+{
+    static AuditLog instance;
+    return instance;
+}
+
+AuditLog::AuditLog()
+    : m_ring(new Slot[RingCapacity])
+    , m_enqueuePos(0)
+    , m_dequeuePos(0)
+    , m_dropped(0)
+    , m_running(false)
+    , m_firstGeneration(0)
+    , m_generation(0)
+    , m_file(nullptr)
+    , m_fileSize(0)
+{
+    for (size_t i = 0; i < RingCapacity; ++i) {
+        m_ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+AuditLog::~AuditLog()
+{
+    stop();
+    delete[] m_ring;
+}
+
+void AuditLog::start(const QString &directory)
+{
+    if (m_running.exchange(true)) {
+        return;
+    }
+    
+    m_directory = directory;
+    QDir().mkpath(m_directory);
+    m_writer = std::thread(&AuditLog::writerLoop, this);
+}
+
+void AuditLog::stop()
+{
+    if (!m_running.exchange(false)) {
+        return;
+    }
+    if (m_writer.joinable()) {
+        m_writer.join();
+    }
+}
+
+bool AuditLog::record(const QString &action, const QString &isbn, const QString &borrower)
+{
+    size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+    Slot *slot;
+    
+    for (;;) {
+        slot = &m_ring[pos & (RingCapacity - 1)];
+        size_t seq = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        
+        if (diff == 0) {
+            if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false; // Ring is full
+        } else {
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    
+    slot->event.timestamp = QDateTime::currentMSecsSinceEpoch();
+    slot->event.action = action;
+    slot->event.isbn = isbn;
+    slot->event.borrower = borrower;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool AuditLog::dequeue(AuditEvent &event)
+{
+    // Single consumer: only the writer thread dequeues
+    size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+    Slot &slot = m_ring[pos & (RingCapacity - 1)];
+    
+    if (slot.sequence.load(std::memory_order_acquire) != pos + 1) {
+        return false;
+    }
+    
+    event = slot.event;
+    slot.event = AuditEvent();
+    m_dequeuePos.store(pos + 1, std::memory_order_relaxed);
+    slot.sequence.store(pos + RingCapacity, std::memory_order_release);
+    return true;
+}
+
+void AuditLog::writerLoop()
+{
+    // Pick up where the previous session left off
+    QStringList files = QDir(m_directory).entryList({"audit-*.log"}, QDir::Files, QDir::Name);
+    bool haveFiles = false;
+    for (const QString &name : files) {
+        bool ok;
+        quint32 generation = name.mid(6, name.length() - 10).toUInt(&ok);
+        if (!ok) {
+            continue;
+        }
+        if (!haveFiles || generation < m_firstGeneration) {
+            m_firstGeneration = generation;
+        }
+        if (!haveFiles || generation > m_generation) {
+            m_generation = generation;
+        }
+        haveFiles = true;
+    }
+    
+    openGeneration(m_generation);
+    
+    AuditEvent event;
+    bool running = true;
+    while (running) {
+        // Drain whatever is left after stop() before exiting
+        running = m_running.load(std::memory_order_acquire);
+        int written = 0;
+        
+        while (dequeue(event)) {
+            if (m_fileSize >= MaxFileSize) {
+                rotate();
+            }
+            
+            QByteArray line = QString("%1\t%2\t%3\t%4\n")
+                              .arg(event.timestamp)
+                              .arg(sanitize(event.action), sanitize(event.isbn), sanitize(event.borrower))
+                              .toUtf8();
+            if (m_file && m_file->write(line) == line.size()) {
+                m_fileSize += line.size();
+            }
+            ++written;
+        }
+        
+        if (written > 0 && m_file) {
+            m_file->flush();
+        } else if (running) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    }
+    
+    delete m_file;
+    m_file = nullptr;
+}
+
+void AuditLog::openGeneration(quint32 generation)
+{
+    delete m_file;
+    m_file = new QFile(filePath(generation));
+    if (!m_file->open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qDebug() << "Failed to open audit log:" << m_file->errorString();
+        delete m_file;
+        m_file = nullptr;
+        m_fileSize = 0;
+        return;
+    }
+    m_fileSize = m_file->size();
+}
+
+void AuditLog::rotate()
+{
+    ++m_generation;
+    openGeneration(m_generation);
+    
+    // Expire the oldest file
+    if (m_generation - m_firstGeneration >= (quint32)MaxFiles) {
+        QFile::remove(filePath(m_firstGeneration++));
+    }
+}
+
+QString AuditLog::filePath(quint32 generation) const
+{
+    return QDir(m_directory).filePath(QString("audit-%1.log").arg(generation, 8, 10, QChar('0')));
+}
+
+QString AuditLog::sanitize(QString field)
+{
+    return field.replace('\t', ' ').replace('\n', ' ').replace('\r', ' ');
+}
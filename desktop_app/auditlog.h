@@ -0,0 +1,72 @@
+#ifndef AUDITLOG_H
+#define AUDITLOG_H
+
+#include <QString>
+#include <QFile>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+struct AuditEvent {
+    qint64 timestamp; // ms since epoch, UTC
+    QString action;   // "checkout" or "return"
+    QString isbn;
+    QString borrower;
+    
+    AuditEvent() : timestamp(0) {}
+};
+
+// Circulation audit trail. Producers only pay a lock-free enqueue into a
+// bounded multi-producer ring; a background thread drains it to rotated
+// log files. Loan history queries go to the loans table, not these files.
+class AuditLog
+{
+public:
+    static AuditLog& instance();
+    
+    void start(const QString &directory);
+    void stop();
+    
+    // Hot path: never blocks, drops the event if the ring is full
+    bool record(const QString &action, const QString &isbn, const QString &borrower);
+    
+    quint64 droppedEvents() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    AuditLog();
+    ~AuditLog();
+    AuditLog(const AuditLog&) = delete;
+    AuditLog& operator=(const AuditLog&) = delete;
+    
+    static const size_t RingCapacity = 4096; // must be a power of two
+    static const qint64 MaxFileSize = 4 * 1024 * 1024;
+    static const int MaxFiles = 8;
+    
+    struct Slot {
+        std::atomic<size_t> sequence;
+        AuditEvent event;
+    };
+    
+    bool dequeue(AuditEvent &event);
+    void writerLoop();
+    void openGeneration(quint32 generation);
+    void rotate();
+    QString filePath(quint32 generation) const;
+    static QString sanitize(QString field);
+    
+    Slot *m_ring;
+    alignas(64) std::atomic<size_t> m_enqueuePos;
+    alignas(64) std::atomic<size_t> m_dequeuePos;
+    std::atomic<quint64> m_dropped;
+    std::atomic<bool> m_running;
+    std::thread m_writer;
+    
+    // Owned by the writer thread while running
+    QString m_directory;
+    quint32 m_firstGeneration;
+    quint32 m_generation;
+    QFile *m_file;
+    qint64 m_fileSize;
+};
+
+#endif // AUDITLOG_H
@@ -0,0 +1,251 @@
+#include "backupmanager.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QVersionNumber>
+
+namespace {
+
+const int ScheduleCheckInterval = 60 * 60 * 1000;  // ms
+const int FirstScheduleCheck = 60 * 1000;          // ms, keeps start-up quiet
+
+bool setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+    return false;
+}
+
+// A QSQLITE connection that is removed again however the backup ends.
+// Queries on it must be declared after it so they go first.
+class Connection
+{
+public:
+    Connection(const QString &name, const QString &path, const QString &options = QString())
+        : m_name(name)
+    {
+        QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", name);
+        database.setDatabaseName(path);
+        database.setConnectOptions(options);
+        m_open = database.open();
+    }
+    
+    ~Connection()
+    {
+        QSqlDatabase::database(m_name, false).close();
+        QSqlDatabase::removeDatabase(m_name);
+    }
+    
+    bool isOpen() const { return m_open; }
+    QSqlDatabase database() const { return QSqlDatabase::database(m_name, false); }
+    QString error() const { return database().lastError().text(); }
+
+private:
+    QString m_name;
+    bool m_open;
+};
+
+} // namespace
+
+BackupManager::BackupManager(const QString &databasePath, QObject *parent)
+    : QObject(parent)
+    , m_databasePath(databasePath)
+    , m_directory(QFileInfo(databasePath).absolutePath() + "/backups")
+    , m_context(new QObject)
+    , m_running(0)
+    , m_cancelled(0)
+    , m_scheduleTimer(new QTimer(this))
+{
+    m_thread.setObjectName("BackupManager");
+    m_context->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_context, &QObject::deleteLater);
+    m_thread.start();
+    
+    connect(m_scheduleTimer, &QTimer::timeout, this, &BackupManager::checkSchedule);
+    
+    // VACUUM INTO arrived in SQLite 3.27; Qt builds older than that carry
+    // an SQLite that cannot take online backups through the driver
+    QString version;
+    {
+        Connection probe("BackupManager-version-check", ":memory:");
+        QSqlQuery query(probe.database());
+        if (probe.isOpen() && query.exec("SELECT sqlite_version()") && query.next()) {
+            version = query.value(0).toString();
+        }
+    }
+    if (QVersionNumber::fromString(version) < QVersionNumber(3, 27)) {
+        m_unavailable = QString("Backups need SQLite 3.27 or later in Qt's SQLite driver (found %1)")
+                        .arg(version.isEmpty() ? QString("none") : version);
+        qDebug() << m_unavailable;
+    }
+}
+
+BackupManager::~BackupManager()
+{
+    cancel();
+    m_thread.quit();
+    m_thread.wait();
+}
+
+QFileInfoList BackupManager::backups() const
+{
+    // Names carry the time they were taken, so they sort by age
+    return QDir(m_directory).entryInfoList(QStringList() << "library-*.db", QDir::Files,
+                                           QDir::Name | QDir::Reversed);
+}
+
+void BackupManager::start()
+{
+    if (!m_running.testAndSetOrdered(0, 1)) {
+        return;
+    }
+    m_cancelled.storeRelease(0);
+    
+    QMetaObject::invokeMethod(m_context, [this]() {
+        run();
+        m_running.storeRelease(0);
+    }, Qt::QueuedConnection);
+}
+
+void BackupManager::cancel()
+{
+    m_cancelled.storeRelease(1);
+}
+
+void BackupManager::startSchedule()
+{
+    m_scheduleTimer->start(ScheduleCheckInterval);
+    QTimer::singleShot(FirstScheduleCheck, this, &BackupManager::checkSchedule);
+}
+
+void BackupManager::checkSchedule()
+{
+    if (isRunning() || !isAvailable()) {
+        return;
+    }
+    
+    QFileInfoList existing = backups();
+    if (existing.isEmpty()
+            || existing.first().lastModified().secsTo(QDateTime::currentDateTime()) >= BackupInterval) {
+        qDebug() << "Starting scheduled backup";
+        start();
+    }
+}
+
+void BackupManager::run()
+{
+    if (!m_unavailable.isEmpty()) {
+        emit finished(false, QString(), m_unavailable);
+        return;
+    }
+    
+    if (!QDir().mkpath(m_directory)) {
+        emit finished(false, QString(), QString("Cannot create %1").arg(m_directory));
+        return;
+    }
+    
+    QString target = QDir(m_directory).filePath(
+        QString("library-%1.db").arg(QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss")));
+    // Not matched by backups() until verified and renamed
+    QString partial = target + ".part";
+    QFile::remove(partial);
+    
+    // The copy runs as one statement; a cancel takes effect after it
+    QString error;
+    bool ok = copy(partial, &error)
+              && (!m_cancelled.loadAcquire() || setError(&error, "Backup cancelled"))
+              && verify(partial, &error);
+    if (ok) {
+        QFile::remove(target);
+        if (!QFile::rename(partial, target)) {
+            ok = setError(&error, QString("Cannot rename %1").arg(partial));
+        }
+    }
+    
+    if (!ok) {
+        QFile::remove(partial);
+        qDebug() << "Backup failed:" << error;
+        emit finished(false, QString(), error);
+        return;
+    }
+    
+    rotate();
+    emit finished(true, target, QString());
+}
+
+bool BackupManager::copy(const QString &target, QString *error)
+{
+    QElapsedTimer timer;
+    timer.start();
+    
+    // Through Qt's own driver, so the live database is only ever opened by
+    // the one SQLite library the app's connections use and its locks are
+    // tracked in one place
+    Connection source("BackupManager-source", m_databasePath,
+                      "QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000");
+    if (!source.isOpen()) {
+        return setError(error, "Cannot open the library: " + source.error());
+    }
+    
+    // VACUUM INTO reads a single snapshot in one read transaction, so in
+    // WAL mode writers carry on meanwhile. The copy comes out compacted and
+    // in rollback-journal mode, as one self-contained file.
+    QSqlQuery query(source.database());
+    query.prepare("VACUUM INTO ?");
+    query.addBindValue(target);
+    if (!query.exec()) {
+        return setError(error, "Backup stopped: " + query.lastError().text());
+    }
+    
+    qDebug() << "Copied" << QFileInfo(target).size() << "bytes in" << timer.elapsed() << "ms";
+    return true;
+}
+
+bool BackupManager::verify(const QString &target, QString *error)
+{
+    QElapsedTimer timer;
+    timer.start();
+    
+    Connection backup("BackupManager-verify", target, "QSQLITE_OPEN_READONLY");
+    if (!backup.isOpen()) {
+        return setError(error, "Cannot open the backup: " + backup.error());
+    }
+    
+    QSqlQuery query(backup.database());
+    if (!query.exec("PRAGMA integrity_check")) {
+        return setError(error, "Cannot check the backup: " + query.lastError().text());
+    }
+    
+    // A healthy file yields a single "ok" row; otherwise one row per problem
+    QStringList problems;
+    while (query.next()) {
+        QString row = query.value(0).toString();
+        if (row != "ok") {
+            problems.append(row);
+        }
+    }
+    
+    if (!problems.isEmpty()) {
+        return setError(error, "Backup failed the integrity check: " + problems.first());
+    }
+    
+    qDebug() << "Verified backup in" << timer.elapsed() << "ms";
+    return true;
+}
+
+void BackupManager::rotate()
+{
+    QFileInfoList existing = backups();
+    for (int i = MaxBackups; i < existing.size(); ++i) {
+        qDebug() << "Removing old backup" << existing.at(i).fileName();
+        QFile::remove(existing.at(i).filePath());
+    }
+}
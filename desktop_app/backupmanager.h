@@ -0,0 +1,62 @@
+#ifndef BACKUPMANAGER_H
+#define BACKUPMANAGER_H
+
+#include <QObject>
+#include <QThread>
+#include <QAtomicInt>
+#include <QFileInfoList>
+#include <QString>
+#include <QTimer>
+
+// Online backups of the library database, taken on a background thread
+// with VACUUM INTO through Qt's SQLite driver while the UI and writers
+// keep running. The copy is taken from one read snapshot, checked with
+// PRAGMA integrity_check and only then given its final name; the newest
+// MaxBackups copies are kept.
+class BackupManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int MaxBackups = 7;
+    static const qint64 BackupInterval = 24 * 60 * 60; // seconds
+    
+    explicit BackupManager(const QString &databasePath, QObject *parent = nullptr);
+    ~BackupManager();
+    
+    QString directory() const { return m_directory; }
+    // Verified backups, newest first
+    QFileInfoList backups() const;
+    
+    // False when Qt's SQLite is too old for VACUUM INTO;
+    // unavailableReason() then says why
+    bool isAvailable() const { return m_unavailable.isEmpty(); }
+    QString unavailableReason() const { return m_unavailable; }
+    bool isRunning() const { return m_running.loadAcquire() != 0; }
+    void start();
+    void cancel();
+    // Backs up whenever the newest backup is older than BackupInterval
+    void startSchedule();
+
+signals:
+    // On failure no new backup is left behind and none is rotated out
+    void finished(bool success, const QString &path, const QString &error);
+
+private:
+    void run();
+    bool copy(const QString &target, QString *error);
+    bool verify(const QString &target, QString *error);
+    void rotate();
+    void checkSchedule();
+    
+    QString m_databasePath;
+    QString m_directory;
+    QString m_unavailable;
+    QThread m_thread;
+    QObject *m_context;     // lives on m_thread, target of posted work
+    QAtomicInt m_running;
+    QAtomicInt m_cancelled;
+    QTimer *m_scheduleTimer;
+};
+
+#endif // BACKUPMANAGER_H
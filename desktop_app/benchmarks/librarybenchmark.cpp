@@ -0,0 +1,423 @@
+// Performance benchmarks for Database, BookModel and the import/export
+// pipeline. Runs headless (QCoreApplication only) against a generated
+// catalog of 10K books; set LIBRARY_BENCHMARK_SIZES=10000,100000,1000000
+// for the larger catalogs. Use QtTest's CSV or XML output
+// (-o results.csv,csv) to track results over time.
+
+#include <QtTest>
+#include <QtConcurrent>
+#include <QTemporaryDir>
+#include "../bookmodel.h"
+#include "../catalogexporter.h"
+#include "../catalogimporter.h"
+#include "../database.h"
+#include "../databasepool.h"
+#include "../isbnfilter.h"
+
+class LibraryBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    
+    void initialize_data() { addSizes(); }
+    void initialize();
+    void getAllBooks_data() { addSizes(); }
+    void getAllBooks();
+    void getBooksPage_data() { addSizes(); }
+    void getBooksPage();
+    void searchBooks_data() { addSizes(); }
+    void searchBooks();
+    void statistics_data() { addSizes(); }
+    void statistics();
+    void modelPopulation_data() { addSizes(); }
+    void modelPopulation();
+    void modelData_data() { addSizes(); }
+    void modelData();
+    void concurrentReads_data() { addSizes(); }
+    void concurrentReads();
+    void exportJson_data() { addSizes(); }
+    void exportJson();
+    void duplicateCheck_data();
+    void duplicateCheck();
+    
+    // These grow the generated catalogs, so they run last
+    void addBook_data() { addSizes(); }
+    void addBook();
+    void updateBook_data() { addSizes(); }
+    void updateBook();
+    void importJson_data() { addSizes(); }
+    void importJson();
+
+private:
+    void addSizes();
+    QString databaseFor(int rows);
+    QString connectionName();
+    Book syntheticBook(qint64 serial) const;
+    
+    QTemporaryDir m_dir;
+    QVector<int> m_sizes;
+    QHash<int, QString> m_paths;
+    // Generated catalogs use serials 0..rows-1; books added by the
+    // benchmarks take serials from here on so they never collide
+    qint64 m_serial = 500000000;
+    int m_connections = 0;
+};
+
+void LibraryBenchmark::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    
+    QByteArray sizes = qgetenv("LIBRARY_BENCHMARK_SIZES");
+    if (sizes.isEmpty()) {
+        sizes = "10000";
+    }
+    for (const QByteArray &size : sizes.split(',')) {
+        int rows = size.trimmed().toInt();
+        if (rows > 0) {
+            m_sizes.append(rows);
+        }
+    }
+    QVERIFY(!m_sizes.isEmpty());
+}
+
+void LibraryBenchmark::cleanupTestCase()
+{
+    DatabasePool::instance().setPath(QString());
+}
+
+void LibraryBenchmark::addSizes()
+{
+    QTest::addColumn<int>("rows");
+    for (int rows : m_sizes) {
+        QTest::newRow(QByteArray::number(rows).constData()) << rows;
+    }
+}
+
+QString LibraryBenchmark::connectionName()
+{
+    return QString("benchmark-%1").arg(++m_connections);
+}
+
+Book LibraryBenchmark::syntheticBook(qint64 serial) const
+{
+    // 978 + nine-digit serial + check digit: a valid, unique ISBN-13
+    QString digits = QString("978%1").arg(serial % 1000000000, 9, 10, QChar('0'));
+    int sum = 0;
+    for (int i = 0; i < 12; ++i) {
+        sum += digits[i].digitValue() * (i % 2 == 0 ? 1 : 3);
+    }
+    digits += QString::number((10 - sum % 10) % 10);
+    
+    static const char *const genres[] = {
+        "Fiction", "Non-Fiction", "Science", "Programming", "History", "Biography",
+        "Mystery", "Romance", "Fantasy", "Science Fiction", "Thriller", "Horror",
+        "Poetry", "Drama", "Comedy", "Other"
+    };
+    return Book(QString("Book %1").arg(serial),
+                QString("Author %1").arg(serial % 5000),
+                digits,
+                genres[serial % 16],
+                1900 + int(serial % 125),
+                serial % 7 == 0);
+}
+
+QString LibraryBenchmark::databaseFor(int rows)
+{
+    auto it = m_paths.constFind(rows);
+    if (it != m_paths.constEnd()) {
+        return it.value();
+    }
+    
+    QString path = m_dir.filePath(QString("library-%1.db").arg(rows));
+    Database database(connectionName());
+    if (!database.initialize(path)) {
+        return QString();
+    }
+    
+    const int batchSize = 10000;
+    for (int total = database.getTotalBooks(); total < rows; ) {
+        QVector<Book> batch;
+        batch.reserve(batchSize);
+        for (int i = 0; i < batchSize && total + i < rows; ++i) {
+            batch.append(syntheticBook(total + i));
+        }
+        ImportResult result = database.addBooks(batch);
+        if (!result.success) {
+            return QString();
+        }
+        total += result.inserted;
+    }
+    database.close();
+    
+    m_paths.insert(rows, path);
+    return path;
+}
+
+void LibraryBenchmark::initialize()
+{
+    QFETCH(int, rows);
+    QString path = databaseFor(rows);
+    QVERIFY(!path.isEmpty());
+    
+    // Cold open of an existing catalog, as at application start
+    QBENCHMARK {
+        Database database(connectionName());
+        QVERIFY(database.initialize(path));
+        database.close();
+    }
+}
+
+void LibraryBenchmark::getAllBooks()
+{
+    QFETCH(int, rows);
+    Database database(connectionName());
+    QVERIFY(database.open(databaseFor(rows), Database::ReadOnly));
+    
+    QBENCHMARK {
+        QVERIFY(database.getAllBooks().size() >= rows);
+    }
+    database.close();
+}
+
+void LibraryBenchmark::getBooksPage()
+{
+    QFETCH(int, rows);
+    Database database(connectionName());
+    QVERIFY(database.open(databaseFor(rows), Database::ReadOnly));
+    
+    // A page from the middle of the title order; keyset seeks should cost
+    // the same at any depth
+    BookSortKey middle(QString("Book %1").arg(rows / 2), 0);
+    
+    QBENCHMARK {
+        QCOMPARE(database.getBooksPage(middle, 256).size(), 256);
+    }
+    database.close();
+}
+
+void LibraryBenchmark::searchBooks()
+{
+    QFETCH(int, rows);
+    Database database(connectionName());
+    QVERIFY(database.open(databaseFor(rows), Database::ReadOnly));
+    
+    QBENCHMARK {
+        QVERIFY(!database.searchBooks("Author 42").isEmpty());
+    }
+    database.close();
+}
+
+void LibraryBenchmark::statistics()
+{
+    QFETCH(int, rows);
+    Database database(connectionName());
+    QVERIFY(database.open(databaseFor(rows), Database::ReadOnly));
+    
+    QBENCHMARK {
+        QVERIFY(database.getStatistics().total >= rows);
+    }
+    database.close();
+}
+
+void LibraryBenchmark::modelPopulation()
+{
+    QFETCH(int, rows);
+    DatabasePool::instance().setPath(databaseFor(rows));
+    BookModel model;
+    
+    // Scroll through the whole catalog page by page
+    QBENCHMARK {
+        model.showCatalog();
+        while (model.canFetchMore(QModelIndex())) {
+            model.fetchMore(QModelIndex());
+        }
+    }
+    QVERIFY(model.rowCount() >= rows);
+}
+
+void LibraryBenchmark::modelData()
+{
+    QFETCH(int, rows);
+    DatabasePool::instance().setPath(databaseFor(rows));
+    BookModel model;
+    model.showCatalog();
+    while (model.rowCount() < 10000 && model.canFetchMore(QModelIndex())) {
+        model.fetchMore(QModelIndex());
+    }
+    
+    // What a view asks for while painting and hovering 10K rows
+    const int roles[] = {Qt::DisplayRole, Qt::BackgroundRole, Qt::ForegroundRole, Qt::ToolTipRole};
+    QBENCHMARK {
+        for (int row = 0; row < qMin(10000, model.rowCount()); ++row) {
+            for (int column = 0; column < model.columnCount(); ++column) {
+                QModelIndex index = model.index(row, column);
+                for (int role : roles) {
+                    model.data(index, role);
+                }
+            }
+        }
+    }
+}
+
+void LibraryBenchmark::concurrentReads()
+{
+    QFETCH(int, rows);
+    QString path = databaseFor(rows);
+    DatabasePool::instance().setPath(path);
+    
+    // Four pooled readers searching while the writer keeps committing
+    const Book target = syntheticBook(rows / 3);
+    QBENCHMARK {
+        QAtomicInt stop(0);
+        QFuture<void> writer = QtConcurrent::run([&stop, target]() {
+            Book book = target;
+            while (!stop.loadAcquire()) {
+                book.checkedOut = !book.checkedOut;
+                DatabasePool::instance().writer()->updateBook(book.ISBN, book);
+            }
+        });
+        
+        QVector<QFuture<int>> readers;
+        for (int i = 0; i < 4; ++i) {
+            readers.append(QtConcurrent::run([i]() {
+                int found = 0;
+                for (int n = 0; n < 25; ++n) {
+                    found += DatabasePool::instance().reader()->searchBooks(QString("Author %1").arg(i * 25 + n)).size();
+                }
+                return found;
+            }));
+        }
+        for (QFuture<int> &reader : readers) {
+            QVERIFY(reader.result() > 0);
+        }
+        
+        stop.storeRelease(1);
+        writer.waitForFinished();
+    }
+}
+
+void LibraryBenchmark::exportJson()
+{
+    QFETCH(int, rows);
+    DatabasePool::instance().setPath(databaseFor(rows));
+    QString fileName = m_dir.filePath(QString("export-%1.json").arg(rows));
+    
+    CatalogExporter exporter;
+    QSignalSpy finished(&exporter, &CatalogExporter::finished);
+    QBENCHMARK_ONCE {
+        exporter.start(fileName, CatalogExporter::Json);
+        QVERIFY(finished.wait(30 * 60 * 1000));
+    }
+    QVERIFY(finished.first().at(0).toBool());
+    QVERIFY(finished.first().at(1).toLongLong() >= rows);
+}
+
+void LibraryBenchmark::duplicateCheck_data()
+{
+    QTest::addColumn<int>("rows");
+    QTest::addColumn<bool>("filtered");
+    for (int rows : m_sizes) {
+        QTest::newRow(QString("%1/query").arg(rows).toLatin1().constData()) << rows << false;
+        QTest::newRow(QString("%1/filter").arg(rows).toLatin1().constData()) << rows << true;
+    }
+}
+
+void LibraryBenchmark::duplicateCheck()
+{
+    QFETCH(int, rows);
+    QFETCH(bool, filtered);
+    DatabasePool::instance().setPath(databaseFor(rows));
+    Database *database = DatabasePool::instance().writer();
+    IsbnFilter *filter = DatabasePool::instance().isbnFilter();
+    if (filtered) {
+        QVERIFY(database->loadIsbnFilter());
+    } else {
+        filter->clear();
+    }
+    filter->resetStatistics();
+    
+    // 10K incoming ISBNs, none in the catalog: the common case for imports
+    QStringList incoming;
+    for (int i = 0; i < 10000; ++i) {
+        incoming.append(syntheticBook(800000000 + i).ISBN);
+    }
+    QBENCHMARK {
+        for (const QString &isbn : qAsConst(incoming)) {
+            QVERIFY(!database->bookExists(isbn));
+        }
+    }
+    
+    // Existing ISBNs must still be found
+    QVERIFY(database->bookExists(syntheticBook(rows / 2).ISBN));
+    
+    if (filtered) {
+        IsbnFilter::Statistics stats = filter->statistics();
+        qInfo("ISBN filter over %lld books: %lld KiB, false positives %.3f%% observed, %.3f%% expected",
+              stats.items, stats.bytes / 1024, stats.observedFalsePositiveRate() * 100,
+              stats.expectedFalsePositiveRate * 100);
+    }
+}
+
+void LibraryBenchmark::addBook()
+{
+    QFETCH(int, rows);
+    Database database(connectionName());
+    QVERIFY(database.open(databaseFor(rows)));
+    
+    QBENCHMARK {
+        QVERIFY(database.addBook(syntheticBook(m_serial++)));
+    }
+    database.close();
+}
+
+void LibraryBenchmark::updateBook()
+{
+    QFETCH(int, rows);
+    Database database(connectionName());
+    QVERIFY(database.open(databaseFor(rows)));
+    
+    Book book = syntheticBook(rows / 2);
+    QBENCHMARK {
+        book.year = book.year == 2000 ? 2001 : 2000;
+        QVERIFY(database.updateBook(book.ISBN, book));
+    }
+    database.close();
+}
+
+void LibraryBenchmark::importJson()
+{
+    QFETCH(int, rows);
+    DatabasePool::instance().setPath(databaseFor(rows));
+    
+    // 10K new books as JSON Lines into a catalog of the given size
+    QString fileName = m_dir.filePath(QString("import-%1.jsonl").arg(rows));
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    for (int i = 0; i < 10000; ++i) {
+        Book book = syntheticBook(m_serial++);
+        QJsonObject json;
+        json["title"] = book.title;
+        json["author"] = book.author;
+        json["ISBN"] = book.ISBN;
+        json["genre"] = book.genre;
+        json["year"] = book.year;
+        json["checkedOut"] = book.checkedOut;
+        file.write(QJsonDocument(json).toJson(QJsonDocument::Compact) + '\n');
+    }
+    file.close();
+    
+    CatalogImporter importer;
+    QSignalSpy finished(&importer, &CatalogImporter::finished);
+    QBENCHMARK_ONCE {
+        importer.start(fileName, CatalogImporter::Json);
+        QVERIFY(finished.wait(30 * 60 * 1000));
+    }
+    QVERIFY(finished.first().at(0).toBool());
+    QCOMPARE(finished.first().at(1).toLongLong(), qint64(10000));
+}
+
+QTEST_GUILESS_MAIN(LibraryBenchmark)
+#include "librarybenchmark.moc"
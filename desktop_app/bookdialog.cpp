@@ -1,6 +1,6 @@
 #include "bookdialog.h"
+#include "databasepool.h"
 #include <QMessageBox>
-#include <QRegularExpression>
 #include <QDate>
 
 BookDialog::BookDialog(QWidget *parent, const Book &book)
@@ -135,34 +135,7 @@ void BookDialog::validateInput()
 
 bool BookDialog::validateISBN(const QString &isbn)
 {
-    // Remove any non-digit characters
-    QString cleanISBN = isbn;
-    cleanISBN.remove(QRegularExpression("[^0-9]"));
-    
-    // Check length (10 or 13 digits)
-    if (cleanISBN.length() != 10 && cleanISBN.length() != 13) {
-        return false;
-    }
-    
-    // Basic ISBN validation
-    if (cleanISBN.length() == 10) {
-        // ISBN-10 validation
-        int sum = 0;
-        for (int i = 0; i < 9; ++i) {
-            sum += cleanISBN[i].digitValue() * (10 - i);
-        }
-        int checkDigit = (11 - (sum % 11)) % 11;
-        return checkDigit == cleanISBN[9].digitValue();
-    } else {
-        // ISBN-13 validation
-        int sum = 0;
-        for (int i = 0; i < 12; ++i) {
-            int digit = cleanISBN[i].digitValue();
-            sum += (i % 2 == 0) ? digit : digit * 3;
-        }
-        int checkDigit = (10 - (sum % 10)) % 10;
-        return checkDigit == cleanISBN[12].digitValue();
-    }
+    return Book::isValidISBN(isbn);
 }
 
 void BookDialog::accept()
@@ -199,7 +172,7 @@ void BookDialog::accept()
     }
     
     // Check for duplicate ISBN (only for new books)
-    if (!m_isEdit && Database::instance().bookExists(m_isbnEdit->text().trimmed())) {
+    if (!m_isEdit && DatabasePool::instance().reader()->bookExists(m_isbnEdit->text().trimmed())) {
         QMessageBox::warning(this, "Duplicate ISBN", "A book with this ISBN already exists.");
         m_isbnEdit->setFocus();
         return;
@@ -1,17 +1,29 @@
 #include "bookmodel.h"
 #include "database.h"
+#include "databasepool.h"
 #include <QColor>
+#include <algorithm>
 
 BookModel::BookModel(QObject *parent)
     : QAbstractTableModel(parent)
+    , m_paged(false)
+    , m_sortColumn(SortByTitle)
+    , m_sortOrder(Qt::AscendingOrder)
+    , m_rowCount(0)
+    , m_atEnd(true)
+    , m_accessClock(0)
+    , m_loadedPages(0)
+    , m_reconcilePending(false)
+    , m_searchTruncated(false)
 {
-    refreshData();
 }
 
 int BookModel::rowCount(const QModelIndex &parent) const
 {
-    Q_UNUSED(parent)
-    return m_books.size();
+    if (parent.isValid()) {
+        return 0;
+    }
+    return m_paged ? m_rowCount : m_books.size();
 }
 
 int BookModel::columnCount(const QModelIndex &parent) const
@@ -22,11 +34,18 @@ int BookModel::columnCount(const QModelIndex &parent) const
 
 QVariant BookModel::data(const QModelIndex &index, int role) const
 {
-    if (!index.isValid() || index.row() >= m_books.size()) {
+    // Shared by every row; data() runs for each visible cell on each paint
+    static const QVariant checkedOutText(QStringLiteral("Checked Out"));
+    static const QVariant availableText(QStringLiteral("Available"));
+    static const QVariant checkedOutBackground(QColor(53, 53, 53));
+    static const QVariant checkedOutForeground(QColor(220, 53, 69));
+    
+    const Row *row = index.isValid() ? rowAt(index.row()) : nullptr;
+    if (!row) {
         return QVariant();
     }
     
-    const Book &book = m_books[index.row()];
+    const Book &book = row->book;
     
     switch (role) {
     case Qt::DisplayRole:
@@ -36,7 +55,7 @@ QVariant BookModel::data(const QModelIndex &index, int role) const
         case 2: return book.ISBN;
         case 3: return book.genre;
         case 4: return book.year;
-        case 5: return book.checkedOut ? "Checked Out" : "Available";
+        case 5: return book.checkedOut ? checkedOutText : availableText;
         }
         break;
         
@@ -48,21 +67,24 @@ QVariant BookModel::data(const QModelIndex &index, int role) const
         
     case Qt::BackgroundRole:
         if (book.checkedOut) {
-            return QColor(53, 53, 53); // Darker background for checked out books
+            return checkedOutBackground; // Darker background for checked out books
         }
         break;
         
     case Qt::ForegroundRole:
         if (book.checkedOut) {
-            return QColor(220, 53, 69); // Red text for checked out books
+            return checkedOutForeground; // Red text for checked out books
         }
         break;
         
     case Qt::ToolTipRole:
-        return QString("Title: %1\nAuthor: %2\nISBN: %3\nGenre: %4\nYear: %5\nStatus: %6")
-               .arg(book.title, book.author, book.ISBN, book.genre)
-               .arg(book.year)
-               .arg(book.checkedOut ? "Checked Out" : "Available");
+        if (!row->toolTip.isValid()) {
+            row->toolTip = QString("Title: %1\nAuthor: %2\nISBN: %3\nGenre: %4\nYear: %5\nStatus: %6")
+                           .arg(book.title, book.author, book.ISBN, book.genre)
+                           .arg(book.year)
+                           .arg(book.checkedOut ? "Checked Out" : "Available");
+        }
+        return row->toolTip;
     }
     
     return QVariant();
@@ -86,21 +108,23 @@ QVariant BookModel::headerData(int section, Qt::Orientation orientation, int rol
 
 bool BookModel::setData(const QModelIndex &index, const QVariant &value, int role)
 {
-    if (!index.isValid() || role != Qt::EditRole) {
+    Row *row = index.isValid() && role == Qt::EditRole ? rowAt(index.row()) : nullptr;
+    if (!row) {
         return false;
     }
     
-    Book &book = m_books[index.row()];
+    Book &book = row->book;
     
     switch (index.column()) {
     case 0: book.title = value.toString(); break;
-    case 1: book.author = value.toString(); break;
+    case 1: book.author = intern(value.toString()); break;
     case 2: book.ISBN = value.toString(); break;
-    case 3: book.genre = value.toString(); break;
+    case 3: book.genre = intern(value.toString()); break;
     case 4: book.year = value.toInt(); break;
     case 5: book.checkedOut = value.toBool(); break;
     default: return false;
     }
+    row->toolTip = QVariant();
     
     emit dataChanged(index, index, {role});
     return true;
@@ -122,29 +146,550 @@ Qt::ItemFlags BookModel::flags(const QModelIndex &index) const
     return flags;
 }
 
-void BookModel::refreshData()
+void BookModel::sort(int column, Qt::SortOrder order)
+{
+    if (column < SortByTitle || column > SortByStatus) {
+        return;
+    }
+    m_sortColumn = static_cast<BookSortColumn>(column);
+    m_sortOrder = order;
+    
+    if (m_paged) {
+        // Re-read from the start in the new order; SQLite walks the index
+        showCatalog();
+        return;
+    }
+    
+    // Search results are already in memory
+    emit layoutAboutToBeChanged();
+    std::stable_sort(m_books.begin(), m_books.end(), [this](const Row &a, const Row &b) {
+        return keyLess(sortKey(a.book), sortKey(b.book));
+    });
+    emit layoutChanged();
+}
+
+bool BookModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && m_paged && !m_atEnd;
+}
+
+void BookModel::fetchMore(const QModelIndex &parent)
+{
+    if (!canFetchMore(parent)) {
+        return;
+    }
+    
+    BookSortKey after = m_pages.isEmpty() ? BookSortKey() : m_pages.last().last;
+    QVector<Book> rows = DatabasePool::instance().reader()->getBooksPage(after, PageSize, m_sortColumn, m_sortOrder);
+    m_atEnd = rows.size() < PageSize;
+    if (rows.isEmpty()) {
+        return;
+    }
+    
+    Page page;
+    page.count = rows.size();
+    page.last = sortKey(rows.last());
+    page.rows = makeRows(rows);
+    page.loaded = true;
+    page.lastUsed = ++m_accessClock;
+    
+    beginInsertRows(QModelIndex(), m_rowCount, m_rowCount + page.count - 1);
+    m_pages.append(page);
+    m_pageStarts.append(m_rowCount);
+    m_rowCount += page.count;
+    ++m_loadedPages;
+    endInsertRows();
+    
+    evictPages();
+}
+
+void BookModel::showCatalog()
 {
     beginResetModel();
-    m_books = Database::instance().getAllBooks();
+    m_paged = true;
+    m_pages.clear();
+    m_pageStarts.clear();
+    m_rowCount = 0;
+    m_atEnd = false;
+    m_loadedPages = 0;
+    m_books.clear();
+    m_searchQuery.clear();
+    m_searchTruncated = false;
+    m_strings.clear();
     endResetModel();
+    
+    // First screen right away; the view asks for more as it scrolls
+    fetchMore(QModelIndex());
 }
 
-void BookModel::searchBooks(const QString &query)
+void BookModel::setBooks(const QVector<Book> &books, const QString &searchQuery)
 {
     beginResetModel();
-    if (query.isEmpty()) {
-        m_books = Database::instance().getAllBooks();
-    } else {
-        m_books = Database::instance().searchBooks(query);
+    m_paged = false;
+    m_pages.clear();
+    m_pageStarts.clear();
+    m_rowCount = 0;
+    m_atEnd = true;
+    m_loadedPages = 0;
+    m_strings.clear();
+    m_books = makeRows(books);
+    m_searchQuery = searchQuery;
+    m_searchTruncated = books.size() >= Database::MaxSearchResults;
+    endResetModel();
+}
+
+bool BookModel::refineSearch(const QString &searchQuery)
+{
+    // A query that only extends the current one matches a subset of the
+    // current results, so they can be filtered here without a new search.
+    // Quoted phrases are exact-token matches and do not narrow that way, and
+    // a capped result set may be missing matches for the longer query.
+    if (m_paged || m_searchTruncated || m_searchQuery.isEmpty() || searchQuery.contains('"')
+        || searchQuery == m_searchQuery || !searchQuery.startsWith(m_searchQuery)) {
+        return false;
     }
-    m_searchQuery = query;
+    
+    // Surviving rows keep their interned strings and cached tooltips
+    const Database &database = *DatabasePool::instance().reader();
+    QVector<Row> refined;
+    for (const Row &row : qAsConst(m_books)) {
+        if (database.matchesSearch(row.book, searchQuery)) {
+            refined.append(row);
+        }
+    }
+    
+    beginResetModel();
+    m_books = refined;
+    m_searchQuery = searchQuery;
     endResetModel();
+    return true;
 }
 
 Book BookModel::getBookAt(int row) const
 {
-    if (row >= 0 && row < m_books.size()) {
-        return m_books[row];
+    const Row *entry = rowAt(row);
+    return entry ? entry->book : Book();
+}
+
+BookModel::Row *BookModel::rowAt(int row) const
+{
+    if (!m_paged) {
+        if (row < 0 || row >= m_books.size()) {
+            return nullptr;
+        }
+        return const_cast<Row *>(&m_books[row]);
+    }
+    
+    if (row < 0 || row >= m_rowCount) {
+        return nullptr;
+    }
+    
+    int index = pageForRow(row);
+    Page &page = m_pages[index];
+    if (!page.loaded) {
+        loadPage(index);
+    }
+    page.lastUsed = ++m_accessClock;
+    
+    int offset = row - m_pageStarts[index];
+    return offset < page.rows.size() ? &page.rows[offset] : nullptr;
+}
+
+int BookModel::pageForRow(int row) const
+{
+    auto it = std::upper_bound(m_pageStarts.constBegin(), m_pageStarts.constEnd(), row);
+    return int(it - m_pageStarts.constBegin()) - 1;
+}
+
+void BookModel::loadPage(int index) const
+{
+    // Re-read exactly the keys the page covered, (previous page's last,
+    // this page's last], so rows other clients added or removed meanwhile
+    // cannot shift rows into or out of its neighbours. Only the final page
+    // of a fully fetched catalog is open-ended.
+    BookSortKey after = index > 0 ? m_pages[index - 1].last : BookSortKey();
+    Page &page = m_pages[index];
+    bool openEnded = m_atEnd && index == m_pages.size() - 1;
+    QVector<Book> books = DatabasePool::instance().reader()->getBooksPage(
+        after, -1, m_sortColumn, m_sortOrder, openEnded ? BookSortKey() : page.last);
+    if (openEnded && !books.isEmpty() && keyLess(page.last, sortKey(books.last()))) {
+        page.last = sortKey(books.last());
+    }
+    
+    page.rows = makeRows(books);
+    page.loaded = true;
+    page.lastUsed = ++m_accessClock;
+    ++m_loadedPages;
+    
+    // This runs from data(), where the row count must not change; the
+    // difference is applied once control is back in the event loop and
+    // rows past the old count stay hidden until then
+    if (page.rows.size() != page.count && !m_reconcilePending) {
+        m_reconcilePending = true;
+        BookModel *model = const_cast<BookModel *>(this);
+        QMetaObject::invokeMethod(model, [model]() { model->reconcilePages(); }, Qt::QueuedConnection);
+    }
+    evictPages();
+}
+
+void BookModel::reconcilePages()
+{
+    m_reconcilePending = false;
+    if (!m_paged) {
+        return;
+    }
+    
+    for (int i = 0; i < m_pages.size(); ++i) {
+        Page &page = m_pages[i];
+        int actual = page.rows.size();
+        if (!page.loaded || actual == page.count) {
+            continue;
+        }
+        
+        // Where inside the page rows came or went is not known, so the
+        // difference is taken at its end and the whole page repainted
+        int start = m_pageStarts[i];
+        int delta = actual - page.count;
+        if (delta > 0) {
+            beginInsertRows(QModelIndex(), start + page.count, start + actual - 1);
+        } else {
+            beginRemoveRows(QModelIndex(), start + actual, start + page.count - 1);
+        }
+        page.count = actual;
+        shiftPageStarts(i + 1, delta);
+        m_rowCount += delta;
+        if (delta > 0) {
+            endInsertRows();
+        } else {
+            endRemoveRows();
+        }
+        
+        if (actual > 0) {
+            emit dataChanged(index(start, 0), index(start + actual - 1, columnCount() - 1));
+        }
+    }
+}
+
+void BookModel::evictPages() const
+{
+    bool evicted = false;
+    while (m_loadedPages > MaxLoadedPages) {
+        int oldest = -1;
+        for (int i = 0; i < m_pages.size(); ++i) {
+            if (m_pages[i].loaded && (oldest < 0 || m_pages[i].lastUsed < m_pages[oldest].lastUsed)) {
+                oldest = i;
+            }
+        }
+        if (oldest < 0) {
+            break;
+        }
+        m_pages[oldest].rows = QVector<Row>();
+        m_pages[oldest].loaded = false;
+        --m_loadedPages;
+        evicted = true;
+    }
+    
+    // Keep only the strings the remaining rows use, so the set follows the
+    // page cap instead of growing with every page ever scrolled past
+    if (evicted) {
+        m_strings.clear();
+        for (const Page &page : qAsConst(m_pages)) {
+            for (const Row &row : page.rows) {
+                m_strings.insert(row.book.author);
+                m_strings.insert(row.book.genre);
+            }
+        }
+    }
+}
+
+void BookModel::insertBook(const Book &book)
+{
+    // The row may be here already, e.g. from a journal change delivered
+    // before this signal
+    if (const Row *shown = findLoaded(book.ISBN)) {
+        Book before = shown->book;
+        updateBook(before, book);
+        return;
+    }
+    
+    if (!m_paged) {
+        if (!m_searchQuery.isEmpty() && DatabasePool::instance().reader()->matchesSearch(book, m_searchQuery)) {
+            beginInsertRows(QModelIndex(), m_books.size(), m_books.size());
+            m_books.append(makeRow(book));
+            endInsertRows();
+        }
+        return;
+    }
+    
+    BookSortKey key = sortKey(book);
+    if (m_pages.isEmpty() && m_atEnd) {
+        // First book of an empty catalog
+        Page page;
+        page.loaded = true;
+        page.lastUsed = ++m_accessClock;
+        m_pages.append(page);
+        m_pageStarts.append(0);
+        ++m_loadedPages;
+    }
+    
+    int index = pageForKey(key);
+    if (index < 0) {
+        return; // Past the fetched range, fetchMore will pick it up
+    }
+    
+    Page &page = m_pages[index];
+    int row = m_pageStarts[index];
+    if (page.loaded) {
+        auto it = std::lower_bound(page.rows.begin(), page.rows.end(), key,
+                                   [this](const Row &r, const BookSortKey &k) { return keyLess(sortKey(r.book), k); });
+        int offset = int(it - page.rows.begin());
+        row += offset;
+        beginInsertRows(QModelIndex(), row, row);
+        page.rows.insert(offset, makeRow(book));
+    } else {
+        // The exact slot is unknown until the page is re-read, which will
+        // include the new row; only the page size has to be right
+        beginInsertRows(QModelIndex(), row, row);
+    }
+    
+    ++page.count;
+    if (keyLess(page.last, key)) {
+        page.last = key;
+    }
+    shiftPageStarts(index + 1, 1);
+    ++m_rowCount;
+    endInsertRows();
+}
+
+void BookModel::updateBook(const Book &before, const Book &after)
+{
+    if (!m_paged) {
+        int row = searchRow(before.ISBN);
+        if (row >= 0) {
+            m_books[row] = makeRow(after);
+            emit dataChanged(index(row, 0), index(row, columnCount() - 1));
+        }
+        return;
+    }
+    
+    BookSortKey oldKey = sortKey(before);
+    BookSortKey newKey = sortKey(after);
+    if (keyLess(oldKey, newKey) || keyLess(newKey, oldKey)) {
+        // The row moves within the sort order
+        removeBook(before);
+        insertBook(after);
+        return;
+    }
+    
+    int index = pageForKey(oldKey);
+    if (index < 0 || !m_pages[index].loaded) {
+        return; // Not fetched or evicted; re-read fresh when needed
+    }
+    
+    int offset = rowInPage(index, before.ISBN);
+    if (offset >= 0) {
+        m_pages[index].rows[offset] = makeRow(after);
+        int row = m_pageStarts[index] + offset;
+        emit dataChanged(this->index(row, 0), this->index(row, columnCount() - 1));
+    }
+}
+
+void BookModel::removeBook(const Book &book)
+{
+    if (!m_paged) {
+        int row = searchRow(book.ISBN);
+        if (row >= 0) {
+            beginRemoveRows(QModelIndex(), row, row);
+            m_books.remove(row);
+            endRemoveRows();
+        }
+        return;
+    }
+    
+    int index = pageForKey(sortKey(book));
+    if (index < 0 || m_pages[index].count == 0) {
+        return;
+    }
+    
+    Page &page = m_pages[index];
+    int row = m_pageStarts[index];
+    if (page.loaded) {
+        int offset = rowInPage(index, book.ISBN);
+        if (offset < 0) {
+            return;
+        }
+        row += offset;
+        beginRemoveRows(QModelIndex(), row, row);
+        page.rows.remove(offset);
+    } else {
+        beginRemoveRows(QModelIndex(), row, row);
+    }
+    
+    --page.count;
+    shiftPageStarts(index + 1, -1);
+    --m_rowCount;
+    endRemoveRows();
+}
+
+bool BookModel::applyChange(const Book &current, bool isNew)
+{
+    const Row *shown = findLoaded(current.ISBN);
+    if (shown) {
+        Book before = shown->book;
+        updateBook(before, current);
+        return true;
+    }
+    
+    if (!m_paged) {
+        insertBook(current);
+        return true;
+    }
+    
+    // A new book has no old position; insertBook() counts it into its page
+    // whether that page is loaded or evicted, and leaves it to fetchMore()
+    // past the fetched range. So does an edited book that is not held
+    // here while every fetched page is, since it was past the fetched range.
+    if (isNew || !hasEvictedPages()) {
+        insertBook(current);
+        return true;
+    }
+    
+    // Otherwise it may have been on an evicted page, and moving it would
+    // leave that page's count wrong
+    return false;
+}
+
+bool BookModel::applyRemoval(const QString &isbn)
+{
+    const Row *shown = findLoaded(isbn);
+    if (shown) {
+        Book removed = shown->book;
+        removeBook(removed);
+        return true;
+    }
+    
+    // Not held here: past the fetched range, or on an evicted page whose
+    // count would then be one too high
+    return !m_paged || !hasEvictedPages();
+}
+
+const BookModel::Row *BookModel::findLoaded(const QString &isbn) const
+{
+    if (!m_paged) {
+        int row = searchRow(isbn);
+        return row >= 0 ? &m_books[row] : nullptr;
+    }
+    
+    for (int i = 0; i < m_pages.size(); ++i) {
+        if (m_pages[i].loaded) {
+            int offset = rowInPage(i, isbn);
+            if (offset >= 0) {
+                return &m_pages[i].rows[offset];
+            }
+        }
+    }
+    return nullptr;
+}
+
+int BookModel::pageForKey(const BookSortKey &key) const
+{
+    // Page i holds the keys in (last of page i-1, last of page i]
+    auto it = std::lower_bound(m_pages.constBegin(), m_pages.constEnd(), key,
+                               [this](const Page &p, const BookSortKey &k) { return keyLess(p.last, k); });
+    if (it != m_pages.constEnd()) {
+        return int(it - m_pages.constBegin());
+    }
+    // Beyond the last fetched row: only ours if the whole catalog is loaded
+    return m_atEnd && !m_pages.isEmpty() ? m_pages.size() - 1 : -1;
+}
+
+int BookModel::rowInPage(int index, const QString &isbn) const
+{
+    const QVector<Row> &rows = m_pages[index].rows;
+    for (int i = 0; i < rows.size(); ++i) {
+        if (rows[i].book.ISBN == isbn) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void BookModel::shiftPageStarts(int fromPage, int delta)
+{
+    for (int i = fromPage; i < m_pageStarts.size(); ++i) {
+        m_pageStarts[i] += delta;
+    }
+}
+
+BookModel::Row BookModel::makeRow(const Book &book) const
+{
+    Row row(book);
+    row.book.author = intern(book.author);
+    row.book.genre = intern(book.genre);
+    return row;
+}
+
+QVector<BookModel::Row> BookModel::makeRows(const QVector<Book> &books) const
+{
+    QVector<Row> rows;
+    rows.reserve(books.size());
+    for (const Book &book : books) {
+        rows.append(makeRow(book));
+    }
+    return rows;
+}
+
+QString BookModel::intern(const QString &value) const
+{
+    // Every row with the same author or genre points at one buffer; the
+    // set holds the canonical copies for the rows currently held
+    auto it = m_strings.constFind(value);
+    if (it != m_strings.constEnd()) {
+        return *it;
+    }
+    return *m_strings.insert(value);
+}
+
+int BookModel::searchRow(const QString &isbn) const
+{
+    for (int i = 0; i < m_books.size(); ++i) {
+        if (m_books[i].book.ISBN == isbn) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+BookSortKey BookModel::sortKey(const Book &book) const
+{
+    switch (m_sortColumn) {
+    case SortByAuthor: return BookSortKey(book.author, book.rowId);
+    case SortByIsbn: return BookSortKey(book.ISBN, book.rowId);
+    case SortByGenre: return BookSortKey(book.genre, book.rowId);
+    case SortByYear: return BookSortKey(book.year, book.rowId);
+    case SortByStatus: return BookSortKey(book.checkedOut ? 1 : 0, book.rowId);
+    case SortByTitle: break;
+    }
+    return BookSortKey(book.title, book.rowId);
+}
+
+bool BookModel::keyLess(const BookSortKey &a, const BookSortKey &b) const
+{
+    // True if a comes before b in the current display order
+    if (a.valid != b.valid) {
+        return !a.valid; // The start position comes before every row
+    }
+    
+    int order;
+    if (m_sortColumn == SortByYear || m_sortColumn == SortByStatus) {
+        qlonglong x = a.value.toLongLong();
+        qlonglong y = b.value.toLongLong();
+        order = x < y ? -1 : (x > y ? 1 : 0);
+    } else {
+        order = a.value.toString().compare(b.value.toString());
+    }
+    if (order == 0) {
+        order = a.rowId < b.rowId ? -1 : (a.rowId > b.rowId ? 1 : 0);
     }
-    return Book();
+    return m_sortOrder == Qt::AscendingOrder ? order < 0 : order > 0;
 }
@@ -3,6 +3,7 @@
 
 #include <QAbstractTableModel>
 #include <QVector>
+#include <QSet>
 #include "database.h"
 
 class BookModel : public QAbstractTableModel
@@ -19,15 +20,95 @@ public:
     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
     bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
     Qt::ItemFlags flags(const QModelIndex &index) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
 
     // Custom methods
-    void refreshData();
-    void searchBooks(const QString &query);
+    void showCatalog();
+    void setBooks(const QVector<Book> &books, const QString &searchQuery = QString());
+    bool refineSearch(const QString &searchQuery);
+    QString searchQuery() const { return m_searchQuery; }
     Book getBookAt(int row) const;
+    
+    // Targeted updates for single-book changes; only the affected row is
+    // touched and the rest of the view (scroll, selection) is preserved
+    void insertBook(const Book &book);
+    void updateBook(const Book &before, const Book &after);
+    void removeBook(const Book &book);
+    
+    // Changes read back from the change journal, which carries only the
+    // current row. The previous version is looked up among the rows held
+    // here; applying a change that is already shown is harmless. Both
+    // return false when the change touches an evicted page at a position
+    // that cannot be known; the caller then reloads the catalog.
+    bool applyChange(const Book &current, bool isNew);
+    bool applyRemoval(const QString &isbn);
 
 private:
-    QVector<Book> m_books;
+    // A book plus its lazily built tooltip, which is dropped whenever the
+    // book changes. Author and genre share storage with every other row
+    // holding the same value (see intern()).
+    struct Row {
+        Book book;
+        mutable QVariant toolTip;
+        
+        Row() {}
+        explicit Row(const Book &b) : book(b) {}
+    };
+    
+    // The catalog is browsed in pages fetched on demand by keyset seeks.
+    // Only a bounded number of pages keep their rows; evicted pages keep
+    // their size and boundary key so they can be reloaded when scrolled to.
+    struct Page {
+        QVector<Row> rows;
+        int count;
+        BookSortKey last; // seek position for the page that follows
+        bool loaded;
+        quint64 lastUsed;
+        
+        Page() : count(0), loaded(false), lastUsed(0) {}
+    };
+    
+    static const int PageSize = 256;
+    static const int MaxLoadedPages = 32;
+    
+    Row *rowAt(int row) const;
+    Row makeRow(const Book &book) const;
+    QVector<Row> makeRows(const QVector<Book> &books) const;
+    QString intern(const QString &value) const;
+    int pageForRow(int row) const;
+    void loadPage(int index) const;
+    void reconcilePages();
+    void evictPages() const;
+    int pageForKey(const BookSortKey &key) const;
+    int rowInPage(int index, const QString &isbn) const;
+    void shiftPageStarts(int fromPage, int delta);
+    int searchRow(const QString &isbn) const;
+    const Row *findLoaded(const QString &isbn) const;
+    bool hasEvictedPages() const { return m_loadedPages < m_pages.size(); }
+    BookSortKey sortKey(const Book &book) const;
+    bool keyLess(const BookSortKey &a, const BookSortKey &b) const;
+    
+    bool m_paged;
+    BookSortColumn m_sortColumn;
+    Qt::SortOrder m_sortOrder;
+    mutable QVector<Page> m_pages;
+    QVector<int> m_pageStarts; // first row of each page
+    int m_rowCount;
+    bool m_atEnd;
+    mutable quint64 m_accessClock;
+    mutable int m_loadedPages;
+    mutable bool m_reconcilePending; // a reloaded page's size changed
+    
+    // Search results are small and held in full
+    QVector<Row> m_books;
     QString m_searchQuery;
+    bool m_searchTruncated; // hit Database::MaxSearchResults
+    
+    // One shared copy of each distinct author and genre among the rows
+    // held; rebuilt from the loaded pages whenever pages are evicted
+    mutable QSet<QString> m_strings;
 };
 
 #endif // BOOKMODEL_H
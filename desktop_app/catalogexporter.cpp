@@ -0,0 +1,200 @@
+#include "catalogexporter.h"
+#include "database.h"
+#include "databasepool.h"
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMetaObject>
+#include <QSaveFile>
+
+namespace {
+
+// Collects output in a fixed buffer and hands it to the file in large
+// writes; the first failed write is remembered and later writes skipped
+class BufferedWriter
+{
+public:
+    static const int Capacity = 256 * 1024;
+    
+    explicit BufferedWriter(QSaveFile &file) : m_file(file), m_ok(true)
+    {
+        m_buffer.reserve(Capacity);
+    }
+    
+    void write(const QByteArray &data)
+    {
+        if (m_buffer.size() + data.size() > Capacity) {
+            flush();
+        }
+        m_buffer.append(data);
+    }
+    
+    bool flush()
+    {
+        if (m_ok && !m_buffer.isEmpty()) {
+            m_ok = m_file.write(m_buffer) == m_buffer.size();
+        }
+        m_buffer.clear();
+        return m_ok;
+    }
+    
+    bool ok() const { return m_ok; }
+
+private:
+    QSaveFile &m_file;
+    QByteArray m_buffer;
+    bool m_ok;
+};
+
+QByteArray jsonRow(const Book &book)
+{
+    QJsonObject jsonBook;
+    jsonBook["title"] = book.title;
+    jsonBook["author"] = book.author;
+    jsonBook["ISBN"] = book.ISBN;
+    jsonBook["genre"] = book.genre;
+    jsonBook["year"] = book.year;
+    jsonBook["checkedOut"] = book.checkedOut;
+    return QJsonDocument(jsonBook).toJson(QJsonDocument::Compact);
+}
+
+// RFC 4180: quote fields containing separators, quotes or line breaks
+QByteArray csvField(const QString &value)
+{
+    QByteArray field = value.toUtf8();
+    if (field.contains(',') || field.contains('"') || field.contains('\n') || field.contains('\r')) {
+        field.replace("\"", "\"\"");
+        field.prepend('"');
+        field.append('"');
+    }
+    return field;
+}
+
+QByteArray csvRow(const Book &book)
+{
+    QByteArray row;
+    row += csvField(book.title) + ',';
+    row += csvField(book.author) + ',';
+    row += csvField(book.ISBN) + ',';
+    row += csvField(book.genre) + ',';
+    row += QByteArray::number(book.year) + ',';
+    row += book.checkedOut ? "true\r\n" : "false\r\n";
+    return row;
+}
+
+} // namespace
+
+CatalogExporter::CatalogExporter(QObject *parent)
+    : QObject(parent)
+    , m_context(new QObject)
+    , m_running(0)
+    , m_cancelled(0)
+{
+    m_thread.setObjectName("CatalogExporter");
+    m_context->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_context, &QObject::deleteLater);
+    m_thread.start();
+}
+
+CatalogExporter::~CatalogExporter()
+{
+    cancel();
+    m_thread.quit();
+    m_thread.wait();
+}
+
+CatalogExporter::Format CatalogExporter::formatForFile(const QString &fileName)
+{
+    QString suffix = QFileInfo(fileName).suffix().toLower();
+    if (suffix == "csv") {
+        return Csv;
+    }
+    if (suffix == "jsonl" || suffix == "ndjson") {
+        return JsonLines;
+    }
+    return Json;
+}
+
+void CatalogExporter::start(const QString &fileName, Format format)
+{
+    if (!m_running.testAndSetOrdered(0, 1)) {
+        return;
+    }
+    m_cancelled.storeRelease(0);
+    
+    QMetaObject::invokeMethod(m_context, [this, fileName, format]() {
+        run(fileName, format);
+        m_running.storeRelease(0);
+    }, Qt::QueuedConnection);
+}
+
+void CatalogExporter::cancel()
+{
+    m_cancelled.storeRelease(1);
+}
+
+void CatalogExporter::run(const QString &fileName, Format format)
+{
+    Database *database = DatabasePool::instance().reader();
+    const qint64 total = database->getTotalBooks();
+    
+    // QSaveFile only replaces the target on commit, so a cancelled or
+    // failed export never leaves a truncated file behind
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        emit finished(false, 0, file.errorString());
+        return;
+    }
+    
+    BufferedWriter writer(file);
+    qint64 written = 0;
+    
+    if (format == Json) {
+        writer.write("[\n");
+    } else if (format == Csv) {
+        writer.write("title,author,ISBN,genre,year,checkedOut\r\n");
+    }
+    
+    bool read = database->forEachBook([&](const Book &book) {
+        if (m_cancelled.loadAcquire()) {
+            return false;
+        }
+        
+        switch (format) {
+        case Json:
+            writer.write(written == 0 ? "  " : ",\n  ");
+            writer.write(jsonRow(book));
+            break;
+        case JsonLines:
+            writer.write(jsonRow(book) + '\n');
+            break;
+        case Csv:
+            writer.write(csvRow(book));
+            break;
+        }
+        
+        if (++written % 1000 == 0) {
+            emit progress(written, total);
+        }
+        return writer.ok();
+    });
+    
+    if (format == Json) {
+        writer.write("\n]\n");
+    }
+    
+    if (m_cancelled.loadAcquire()) {
+        file.cancelWriting();
+        emit cancelled(written);
+        return;
+    }
+    
+    if (!read || !writer.flush() || !file.commit()) {
+        file.cancelWriting();
+        emit finished(false, written, read ? file.errorString() : "Failed to read the catalog");
+        return;
+    }
+    
+    emit progress(written, total);
+    emit finished(true, written, QString());
+}
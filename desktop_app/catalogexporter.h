@@ -0,0 +1,43 @@
+#ifndef CATALOGEXPORTER_H
+#define CATALOGEXPORTER_H
+
+#include <QObject>
+#include <QThread>
+#include <QAtomicInt>
+#include <QString>
+
+// Writes the whole catalog to a file on a background thread. Rows are
+// streamed from a forward-only cursor through a fixed-size write buffer,
+// so memory use does not grow with the size of the library.
+class CatalogExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Format { Json, JsonLines, Csv };
+    
+    explicit CatalogExporter(QObject *parent = nullptr);
+    ~CatalogExporter();
+    
+    static Format formatForFile(const QString &fileName);
+    
+    bool isRunning() const { return m_running.loadAcquire() != 0; }
+    void start(const QString &fileName, Format format);
+    void cancel();
+
+signals:
+    void progress(qint64 written, qint64 total);
+    // On failure or cancellation the target file is left untouched
+    void finished(bool success, qint64 written, const QString &error);
+    void cancelled(qint64 written);
+
+private:
+    void run(const QString &fileName, Format format);
+    
+    QThread m_thread;
+    QObject *m_context;     // lives on m_thread, target of posted work
+    QAtomicInt m_running;
+    QAtomicInt m_cancelled;
+};
+
+#endif // CATALOGEXPORTER_H
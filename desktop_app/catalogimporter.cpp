@@ -0,0 +1,415 @@
+#include "catalogimporter.h"
+#include "database.h"
+#include "databasepool.h"
+#include "marcreader.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMetaObject>
+#include <QQueue>
+#include <QtConcurrent>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+const int ChunkSize = 1024 * 1024;
+const int BatchSize = 2000;
+const int MaxElementSize = 16 * 1024 * 1024;
+
+// Splits a byte stream into whole records without parsing them
+class RecordScanner
+{
+public:
+    virtual ~RecordScanner() {}
+    // Appends completed records to out; false if a record grew too large
+    virtual bool feed(const char *data, int size, QVector<QByteArray> &out) = 0;
+    // True if the input ended inside a record
+    virtual bool inRecord() const = 0;
+};
+
+// Top-level JSON objects. Works for a single array of objects as well as
+// for one object per line; anything between objects (brackets, commas,
+// whitespace) is skipped. Strings are tracked so braces inside titles
+// do not confuse the nesting count.
+class JsonObjectScanner : public RecordScanner
+{
+public:
+    JsonObjectScanner() : m_depth(0), m_inString(false), m_escaped(false) {}
+    
+    bool feed(const char *data, int size, QVector<QByteArray> &out) override
+    {
+        int start = m_depth > 0 ? 0 : -1;
+        
+        for (int i = 0; i < size; ++i) {
+            char c = data[i];
+            
+            if (m_depth == 0) {
+                if (c == '{') {
+                    start = i;
+                    m_depth = 1;
+                }
+                continue;
+            }
+            
+            if (m_inString) {
+                if (m_escaped) {
+                    m_escaped = false;
+                } else if (c == '\\') {
+                    m_escaped = true;
+                } else if (c == '"') {
+                    m_inString = false;
+                }
+                continue;
+            }
+            
+            if (c == '"') {
+                m_inString = true;
+            } else if (c == '{' || c == '[') {
+                ++m_depth;
+            } else if ((c == '}' || c == ']') && --m_depth == 0) {
+                m_element.append(data + start, i + 1 - start);
+                out.append(m_element);
+                m_element.clear();
+                start = -1;
+            }
+        }
+        
+        if (start >= 0) {
+            m_element.append(data + start, size - start);
+        }
+        return m_element.size() <= MaxElementSize;
+    }
+    
+    bool inRecord() const override { return m_depth > 0; }
+
+private:
+    QByteArray m_element;
+    int m_depth;
+    bool m_inString;
+    bool m_escaped;
+};
+
+// ISO 2709 records, each ended by the record terminator (0x1D). Line
+// breaks some tools put between records are dropped.
+class Iso2709Scanner : public RecordScanner
+{
+public:
+    bool feed(const char *data, int size, QVector<QByteArray> &out) override
+    {
+        const char *end = data + size;
+        while (data < end) {
+            const char *terminator = static_cast<const char *>(memchr(data, RecordTerminator, end - data));
+            if (!terminator) {
+                m_record.append(data, int(end - data));
+                break;
+            }
+            m_record.append(data, int(terminator + 1 - data));
+            int leading = 0;
+            while (leading < m_record.size() && (m_record[leading] == '\n' || m_record[leading] == '\r')) {
+                ++leading;
+            }
+            out.append(m_record.mid(leading));
+            m_record.clear();
+            data = terminator + 1;
+        }
+        return m_record.size() <= MaxElementSize;
+    }
+    
+    bool inRecord() const override { return !m_record.trimmed().isEmpty(); }
+
+private:
+    static const char RecordTerminator = 0x1D;
+    QByteArray m_record;
+};
+
+// <record> elements of a MARCXML collection, with or without a
+// namespace prefix; the enclosing <collection> is skipped
+class MarcXmlScanner : public RecordScanner
+{
+public:
+    MarcXmlScanner() : m_inRecord(false), m_searchFrom(0) {}
+    
+    bool feed(const char *data, int size, QVector<QByteArray> &out) override
+    {
+        m_buffer.append(data, size);
+        
+        for (;;) {
+            if (!m_inRecord) {
+                int start = findRecordTag(m_buffer, 0, false);
+                if (start < 0) {
+                    // Keep a tail in case a start tag straddles the chunk
+                    m_buffer.remove(0, qMax(0, m_buffer.size() - 64));
+                    break;
+                }
+                m_buffer.remove(0, start);
+                m_inRecord = true;
+                m_searchFrom = 1;
+            }
+            
+            int close = findRecordTag(m_buffer, m_searchFrom, true);
+            int end = close < 0 ? -1 : m_buffer.indexOf('>', close);
+            if (end < 0) {
+                m_searchFrom = qMax(1, m_buffer.size() - 64);
+                break;
+            }
+            out.append(m_buffer.left(end + 1));
+            m_buffer.remove(0, end + 1);
+            m_inRecord = false;
+        }
+        
+        return m_buffer.size() <= MaxElementSize;
+    }
+    
+    bool inRecord() const override { return m_inRecord; }
+
+private:
+    // Position of the '<' of the next <record ...> or </record>, where
+    // the element name may carry a prefix ("marc:record")
+    static int findRecordTag(const QByteArray &buffer, int from, bool closing)
+    {
+        for (int open = buffer.indexOf('<', from); open >= 0; open = buffer.indexOf('<', open + 1)) {
+            int name = open + 1;
+            if (closing != (name < buffer.size() && buffer[name] == '/')) {
+                continue;
+            }
+            if (closing) {
+                ++name;
+            }
+            int nameEnd = name;
+            while (nameEnd < buffer.size() && !isNameEnd(buffer[nameEnd])) {
+                ++nameEnd;
+            }
+            if (nameEnd == buffer.size()) {
+                return -1;
+            }
+            int local = name;
+            for (int i = name; i < nameEnd; ++i) {
+                if (buffer[i] == ':') {
+                    local = i + 1;
+                }
+            }
+            if (nameEnd - local == 6 && memcmp(buffer.constData() + local, "record", 6) == 0) {
+                return open;
+            }
+        }
+        return -1;
+    }
+    
+    static bool isNameEnd(char c)
+    {
+        return c == '>' || c == '/' || c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+    
+    QByteArray m_buffer;
+    bool m_inRecord;
+    int m_searchFrom;
+};
+
+struct ValidatedBatch {
+    QVector<Book> books;
+    int invalid = 0;
+};
+
+bool bookFromJson(const QByteArray &record, Book &book)
+{
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(record, &error);
+    if (error.error != QJsonParseError::NoError || !doc.isObject()) {
+        return false;
+    }
+    
+    QJsonObject jsonBook = doc.object();
+    book.title = jsonBook["title"].toString().trimmed();
+    book.author = jsonBook["author"].toString().trimmed();
+    book.ISBN = jsonBook["ISBN"].toString().trimmed();
+    book.genre = jsonBook["genre"].toString().trimmed();
+    book.year = jsonBook["year"].toInt();
+    book.checkedOut = jsonBook["checkedOut"].toBool();
+    return true;
+}
+
+// Runs on the thread pool: parse each record and apply the same rules
+// as BookDialog, so imported books are ones the UI could have created
+ValidatedBatch validateBatch(CatalogImporter::Format format, const QVector<QByteArray> &records)
+{
+    ValidatedBatch batch;
+    batch.books.reserve(records.size());
+    
+    for (const QByteArray &record : records) {
+        Book book;
+        bool parsed = false;
+        switch (format) {
+        case CatalogImporter::Json:
+            parsed = bookFromJson(record, book);
+            break;
+        case CatalogImporter::Marc21:
+            parsed = MarcReader::fromIso2709(record, book);
+            break;
+        case CatalogImporter::MarcXml:
+            parsed = MarcReader::fromMarcXml(record, book);
+            break;
+        }
+        
+        if (!parsed || book.title.isEmpty() || book.author.isEmpty() || !Book::isValidISBN(book.ISBN)) {
+            batch.invalid++;
+            continue;
+        }
+        batch.books.append(book);
+    }
+    
+    return batch;
+}
+
+} // namespace
+
+CatalogImporter::CatalogImporter(QObject *parent)
+    : QObject(parent)
+    , m_context(new QObject)
+    , m_running(0)
+    , m_cancelled(0)
+{
+    m_thread.setObjectName("CatalogImporter");
+    m_context->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_context, &QObject::deleteLater);
+    m_thread.start();
+}
+
+CatalogImporter::~CatalogImporter()
+{
+    cancel();
+    m_thread.quit();
+    m_thread.wait();
+}
+
+CatalogImporter::Format CatalogImporter::formatForFile(const QString &fileName)
+{
+    QString suffix = QFileInfo(fileName).suffix().toLower();
+    if (suffix == "mrc" || suffix == "marc") {
+        return Marc21;
+    }
+    if (suffix == "xml" || suffix == "marcxml") {
+        return MarcXml;
+    }
+    return Json;
+}
+
+void CatalogImporter::start(const QString &fileName, Format format)
+{
+    if (!m_running.testAndSetOrdered(0, 1)) {
+        return;
+    }
+    m_cancelled.storeRelease(0);
+    
+    QMetaObject::invokeMethod(m_context, [this, fileName, format]() {
+        run(fileName, format);
+        m_running.storeRelease(0);
+    }, Qt::QueuedConnection);
+}
+
+void CatalogImporter::cancel()
+{
+    m_cancelled.storeRelease(1);
+}
+
+void CatalogImporter::run(const QString &fileName, Format format)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        emit finished(false, 0, 0, 0, file.errorString());
+        return;
+    }
+    
+    Database *database = DatabasePool::instance().writer();
+    const qint64 total = file.size();
+    const int maxInFlight = qMax(2, QThread::idealThreadCount());
+    
+    std::unique_ptr<RecordScanner> scanner;
+    switch (format) {
+    case Json:
+        scanner.reset(new JsonObjectScanner);
+        break;
+    case Marc21:
+        scanner.reset(new Iso2709Scanner);
+        break;
+    case MarcXml:
+        scanner.reset(new MarcXmlScanner);
+        break;
+    }
+    QVector<QByteArray> records;
+    QQueue<QFuture<ValidatedBatch>> pending;
+    QByteArray chunk(ChunkSize, Qt::Uninitialized);
+    qint64 bytesRead = 0;
+    qint64 inserted = 0;
+    qint64 skipped = 0;
+    qint64 invalid = 0;
+    QString error;
+    
+    // Batches are written in file order, so the first of several records
+    // with the same ISBN wins just as it would in a sequential import
+    auto writeOldest = [&]() {
+        ValidatedBatch batch = pending.dequeue().result();
+        invalid += batch.invalid;
+        if (batch.books.isEmpty()) {
+            return true;
+        }
+        ImportResult result = database->addBooks(batch.books);
+        if (!result.success) {
+            error = "Failed to write imported books";
+            return false;
+        }
+        inserted += result.inserted;
+        skipped += result.skipped;
+        return true;
+    };
+    
+    while (error.isEmpty() && !m_cancelled.loadAcquire()) {
+        qint64 size = file.read(chunk.data(), ChunkSize);
+        if (size < 0) {
+            error = file.errorString();
+            break;
+        }
+        
+        if (!scanner->feed(chunk.constData(), int(size), records)) {
+            error = "Record too large; the file does not match the selected format";
+            break;
+        }
+        bytesRead += size;
+        
+        bool atEnd = size == 0;
+        while (records.size() >= BatchSize || (atEnd && !records.isEmpty())) {
+            QVector<QByteArray> batch = records.mid(0, BatchSize);
+            records.remove(0, batch.size());
+            pending.enqueue(QtConcurrent::run(validateBatch, format, batch));
+            
+            if (pending.size() >= maxInFlight && !writeOldest()) {
+                break;
+            }
+        }
+        
+        if (atEnd) {
+            if (scanner->inRecord()) {
+                invalid++; // truncated final record
+            }
+            break;
+        }
+        emit progress(bytesRead, total, inserted);
+    }
+    
+    while (!pending.isEmpty()) {
+        if (error.isEmpty() && !m_cancelled.loadAcquire()) {
+            writeOldest();
+        } else {
+            pending.dequeue().waitForFinished();
+        }
+    }
+    
+    if (m_cancelled.loadAcquire()) {
+        emit cancelled(inserted);
+        return;
+    }
+    
+    emit progress(bytesRead, total, inserted);
+    emit finished(error.isEmpty(), inserted, skipped, invalid, error);
+}
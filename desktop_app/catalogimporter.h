@@ -0,0 +1,46 @@
+#ifndef CATALOGIMPORTER_H
+#define CATALOGIMPORTER_H
+
+#include <QObject>
+#include <QThread>
+#include <QAtomicInt>
+#include <QString>
+
+// Imports books from a JSON array (or JSON Lines), MARC 21 (ISO 2709) or
+// MARCXML file on a background thread. The file is split into records
+// incrementally, batches of records are parsed and validated on the
+// global thread pool, and each valid batch is inserted in its own
+// transaction, so memory is bounded by the number of batches in flight
+// rather than by the size of the file.
+class CatalogImporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Format { Json, Marc21, MarcXml };
+    
+    explicit CatalogImporter(QObject *parent = nullptr);
+    ~CatalogImporter();
+    
+    static Format formatForFile(const QString &fileName);
+    
+    bool isRunning() const { return m_running.loadAcquire() != 0; }
+    void start(const QString &fileName, Format format);
+    void cancel();
+
+signals:
+    void progress(qint64 bytesRead, qint64 bytesTotal, qint64 imported);
+    // Batches committed before a failure or cancellation are kept
+    void finished(bool success, qint64 inserted, qint64 skipped, qint64 invalid, const QString &error);
+    void cancelled(qint64 inserted);
+
+private:
+    void run(const QString &fileName, Format format);
+    
+    QThread m_thread;
+    QObject *m_context;     // lives on m_thread, target of posted work
+    QAtomicInt m_running;
+    QAtomicInt m_cancelled;
+};
+
+#endif // CATALOGIMPORTER_H
@@ -1,6 +1,71 @@
 #include "database.h"
+#include "databasepool.h"
+#include "querystatistics.h"
 #include <QApplication>
+#include <QElapsedTimer>
 #include <QSqlRecord>
+#include <QRegularExpression>
+
+namespace {
+
+const QRegularExpression &wordSeparators()
+{
+    static const QRegularExpression separators("[^\\w]+");
+    return separators;
+}
+
+// Case-folds and strips combining marks, as the unicode61 tokenizer does,
+// so "Bronte" finds "Brontë" in memory the same way it does in books_fts
+QString foldForSearch(const QString &text)
+{
+    QString decomposed = text.normalized(QString::NormalizationForm_D);
+    QString folded;
+    folded.reserve(decomposed.size());
+    for (QChar c : decomposed) {
+        if (c.category() != QChar::Mark_NonSpacing) {
+            folded.append(c);
+        }
+    }
+    return folded.toCaseFolded();
+}
+
+} // namespace
+
+bool Book::isValidISBN(const QString &isbn)
+{
+    // Collect the digits without allocating; runs once per imported row
+    int digits[13];
+    int count = 0;
+    bool checkX = false;
+    for (QChar c : isbn) {
+        if (c >= QLatin1Char('0') && c <= QLatin1Char('9')) {
+            if (count == 13 || checkX) {
+                return false;
+            }
+            digits[count++] = c.unicode() - '0';
+        } else if ((c == QLatin1Char('X') || c == QLatin1Char('x')) && count == 9) {
+            // ISBN-10 writes a check digit of 10 as a final X
+            digits[count++] = 10;
+            checkX = true;
+        }
+    }
+    
+    if (count == 10) {
+        int sum = 0;
+        for (int i = 0; i < 9; ++i) {
+            sum += digits[i] * (10 - i);
+        }
+        return (11 - (sum % 11)) % 11 == digits[9];
+    }
+    if (count == 13) {
+        int sum = 0;
+        for (int i = 0; i < 12; ++i) {
+            sum += (i % 2 == 0) ? digits[i] : digits[i] * 3;
+        }
+        return (10 - (sum % 10)) % 10 == digits[12];
+    }
+    return false;
+}
 
 Database& Database::instance()
 {
@@ -8,22 +73,80 @@ Database& Database::instance()
     return instance;
 }
 
-bool Database::initialize()
+Database::Database()
+    : m_connectionName(QLatin1String(QSqlDatabase::defaultConnection))
+{
+}
+
+Database::Database(const QString &connectionName, QObject *parent)
+    : QObject(parent)
+    , m_connectionName(connectionName)
+{
+}
+
+QString Database::defaultPath()
 {
-    // Set up database path
     QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
     QDir().mkpath(dataPath);
-    QString dbPath = dataPath + "/library.db";
-    
-    // Initialize SQLite database
-    m_database = QSqlDatabase::addDatabase("QSQLITE");
-    m_database.setDatabaseName(dbPath);
+    return dataPath + "/library.db";
+}
+
+bool Database::open(const QString &path, OpenMode mode)
+{
+    m_statements.clear();
+    m_database = QSqlDatabase::addDatabase("QSQLITE", m_connectionName);
+    m_database.setDatabaseName(path);
+    if (mode == ReadOnly) {
+        m_database.setConnectOptions("QSQLITE_OPEN_READONLY");
+    }
     
     if (!m_database.open()) {
         qDebug() << "Failed to open database:" << m_database.lastError().text();
         return false;
     }
     
+    // WAL lets readers on other connections run alongside the writer
+    QSqlQuery query(m_database);
+    if (mode == ReadWrite) {
+        query.exec("PRAGMA journal_mode = WAL");
+        query.exec("PRAGMA synchronous = NORMAL");
+    }
+    query.exec("PRAGMA busy_timeout = 5000");
+    
+    m_hasFullText = query.exec("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'books_fts'")
+                    && query.next();
+    query.finish();
+    
+    return true;
+}
+
+void Database::close()
+{
+    m_statements.clear();
+    if (m_database.isValid()) {
+        m_database.close();
+        m_database = QSqlDatabase();
+        QSqlDatabase::removeDatabase(m_connectionName);
+    }
+}
+
+bool Database::initialize(const QString &path)
+{
+    if (!open(path)) {
+        return false;
+    }
+    
+    return ensureSchema();
+}
+
+bool Database::ensureSchema()
+{
+    // A current stamp means every table, index and trigger exists; skip
+    // the DDL so opening an existing library costs a single read
+    if (scalar("PRAGMA user_version").toInt() == SchemaVersion) {
+        return true;
+    }
+    
     // Create tables
     if (!createTables()) {
         qDebug() << "Failed to create tables";
@@ -31,16 +154,21 @@ bool Database::initialize()
     }
     
     // Insert sample data if database is empty
-    if (getTotalBooks() == 0) {
+    if (!scalar("SELECT EXISTS(SELECT 1 FROM books)").toBool()) {
         insertSampleData();
     }
     
+    QSqlQuery query(m_database);
+    if (!query.exec(QString("PRAGMA user_version = %1").arg(SchemaVersion))) {
+        qDebug() << "Failed to stamp schema version:" << query.lastError().text();
+    }
+    
     return true;
 }
 
 bool Database::createTables()
 {
-    QSqlQuery query;
+    QSqlQuery query(m_database);
     
     // Create books table
     QString createTableSQL = R"(
@@ -65,10 +193,140 @@ bool Database::createTables()
     query.exec("CREATE INDEX IF NOT EXISTS idx_books_title ON books(title)");
     query.exec("CREATE INDEX IF NOT EXISTS idx_books_author ON books(author)");
     query.exec("CREATE INDEX IF NOT EXISTS idx_books_genre ON books(genre)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_books_year ON books(year)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_books_checked_out ON books(checked_out)");
+    
+    // Change journal: every write to books is appended in commit order so
+    // that clients sharing the file can find which books changed since
+    // they last looked and refresh only those
+    QString createChangesSQL = R"(
+        CREATE TABLE IF NOT EXISTS book_changes (
+            seq INTEGER PRIMARY KEY AUTOINCREMENT,
+            isbn TEXT NOT NULL,
+            operation TEXT NOT NULL,
+            changed_at DATETIME DEFAULT CURRENT_TIMESTAMP
+        )
+    )";
+    
+    if (!query.exec(createChangesSQL)) {
+        qDebug() << "Failed to create book_changes table:" << query.lastError().text();
+        return false;
+    }
+    
+    query.exec(R"(
+        CREATE TRIGGER IF NOT EXISTS trg_books_insert AFTER INSERT ON books BEGIN
+            INSERT INTO book_changes (isbn, operation) VALUES (new.isbn, 'I');
+        END
+    )");
+    query.exec(R"(
+        CREATE TRIGGER IF NOT EXISTS trg_books_update AFTER UPDATE ON books BEGIN
+            INSERT INTO book_changes (isbn, operation) VALUES (new.isbn, 'U');
+        END
+    )");
+    query.exec(R"(
+        CREATE TRIGGER IF NOT EXISTS trg_books_delete AFTER DELETE ON books BEGIN
+            INSERT INTO book_changes (isbn, operation) VALUES (old.isbn, 'D');
+        END
+    )");
+    
+    // Circulation history. Open loans (returned_at IS NULL) are a small,
+    // hot subset of a table that keeps every loan ever made, so the
+    // due-date index covers only those; history lookups use the
+    // (isbn|borrower, checked_out_at) indexes and never scan the table.
+    // Timestamps are UTC 'YYYY-MM-DD HH:MM:SS' text, which sorts correctly.
+    QString createLoansSQL = R"(
+        CREATE TABLE IF NOT EXISTS loans (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            isbn TEXT NOT NULL,
+            borrower TEXT NOT NULL,
+            checked_out_at DATETIME NOT NULL DEFAULT CURRENT_TIMESTAMP,
+            due_at DATETIME NOT NULL,
+            returned_at DATETIME
+        )
+    )";
+    
+    if (!query.exec(createLoansSQL)) {
+        qDebug() << "Failed to create loans table:" << query.lastError().text();
+        return false;
+    }
+    
+    query.exec("CREATE INDEX IF NOT EXISTS idx_loans_isbn ON loans(isbn, checked_out_at)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_loans_borrower ON loans(borrower, checked_out_at)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_loans_due ON loans(due_at) WHERE returned_at IS NULL");
+    // At most one open loan per book
+    query.exec("CREATE UNIQUE INDEX IF NOT EXISTS idx_loans_open ON loans(isbn) WHERE returned_at IS NULL");
+    
+    // Views over the indexes above; filter them by isbn / borrower
+    query.exec(R"(
+        CREATE VIEW IF NOT EXISTS overdue_loans AS
+        SELECT l.id, l.isbn, COALESCE(b.title, ''), l.borrower, l.checked_out_at, l.due_at, l.returned_at
+        FROM loans l LEFT JOIN books b ON b.isbn = l.isbn
+        WHERE l.returned_at IS NULL AND l.due_at < datetime('now')
+    )");
+    query.exec(R"(
+        CREATE VIEW IF NOT EXISTS loans_by_borrower AS
+        SELECT l.id, l.isbn, COALESCE(b.title, ''), l.borrower, l.checked_out_at, l.due_at, l.returned_at
+        FROM loans l LEFT JOIN books b ON b.isbn = l.isbn
+    )");
+    query.exec(R"(
+        CREATE VIEW IF NOT EXISTS book_loan_history AS
+        SELECT l.id, l.isbn, COALESCE(b.title, ''), l.borrower, l.checked_out_at, l.due_at, l.returned_at
+        FROM loans l LEFT JOIN books b ON b.isbn = l.isbn
+    )");
+    
+    createFullTextIndex();
     
     return true;
 }
 
+void Database::createFullTextIndex()
+{
+    QSqlQuery query(m_database);
+    
+    // Existing databases get the index built once from the current rows
+    bool exists = query.exec("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'books_fts'")
+                  && query.next();
+    query.finish();
+    
+    m_hasFullText = query.exec(R"(
+        CREATE VIRTUAL TABLE IF NOT EXISTS books_fts USING fts5(
+            title, author, isbn, genre,
+            content = 'books', content_rowid = 'rowid'
+        )
+    )");
+    
+    if (!m_hasFullText) {
+        qDebug() << "Full-text search unavailable, using LIKE search:" << query.lastError().text();
+        return;
+    }
+    
+    // Keep the external-content index in sync with books
+    query.exec(R"(
+        CREATE TRIGGER IF NOT EXISTS trg_books_fts_insert AFTER INSERT ON books BEGIN
+            INSERT INTO books_fts (rowid, title, author, isbn, genre)
+            VALUES (new.rowid, new.title, new.author, new.isbn, new.genre);
+        END
+    )");
+    query.exec(R"(
+        CREATE TRIGGER IF NOT EXISTS trg_books_fts_delete AFTER DELETE ON books BEGIN
+            INSERT INTO books_fts (books_fts, rowid, title, author, isbn, genre)
+            VALUES ('delete', old.rowid, old.title, old.author, old.isbn, old.genre);
+        END
+    )");
+    query.exec(R"(
+        CREATE TRIGGER IF NOT EXISTS trg_books_fts_update AFTER UPDATE ON books BEGIN
+            INSERT INTO books_fts (books_fts, rowid, title, author, isbn, genre)
+            VALUES ('delete', old.rowid, old.title, old.author, old.isbn, old.genre);
+            INSERT INTO books_fts (rowid, title, author, isbn, genre)
+            VALUES (new.rowid, new.title, new.author, new.isbn, new.genre);
+        END
+    )");
+    
+    if (!exists && !query.exec("INSERT INTO books_fts (books_fts) VALUES ('rebuild')")) {
+        qDebug() << "Failed to build full-text index:" << query.lastError().text();
+    }
+}
+
 void Database::insertSampleData()
 {
     QVector<Book> sampleBooks = {
@@ -84,91 +342,425 @@ void Database::insertSampleData()
         Book("Introduction to Algorithms", "Thomas H. Cormen", "9780262033848", "Programming", 2009)
     };
     
-    for (const Book &book : sampleBooks) {
-        addBook(book);
-    }
+    addBooks(sampleBooks);
 }
 
 bool Database::addBook(const Book &book)
 {
+    QMutexLocker writeLock(DatabasePool::instance().writeLock());
+    
     if (bookExists(book.ISBN)) {
         return false; // Book already exists
     }
     
-    QSqlQuery query;
-    query.prepare(R"(
+    QSqlQuery query = statement(R"(
         INSERT INTO books (isbn, title, author, genre, year, checked_out)
         VALUES (?, ?, ?, ?, ?, ?)
     )");
     
-    query.addBindValue(book.ISBN);
-    query.addBindValue(book.title);
-    query.addBindValue(book.author);
-    query.addBindValue(book.genre);
-    query.addBindValue(book.year);
-    query.addBindValue(book.checkedOut);
+    query.bindValue(0, book.ISBN);
+    query.bindValue(1, book.title);
+    query.bindValue(2, book.author);
+    query.bindValue(3, book.genre);
+    query.bindValue(4, book.year);
+    query.bindValue(5, book.checkedOut);
+    
+    if (!beginWrite()) {
+        return false;
+    }
     
-    if (!query.exec()) {
+    QueryTrace trace(m_database, query);
+    if (!trace.exec()) {
         qDebug() << "Failed to add book:" << query.lastError().text();
+        m_database.rollback();
         return false;
     }
+    qint64 rowId = query.lastInsertId().toLongLong();
+    
+    if (!commitWrite()) {
+        return false;
+    }
+    
+    if (IsbnFilter *filter = isbnFilter()) {
+        filter->insert(book.ISBN);
+        if (filter->needsRebuild()) {
+            rebuildIsbnFilter();
+        }
+    }
+    
+    Book added = book;
+    added.rowId = rowId;
+    emit bookAdded(added);
     
     return true;
 }
 
+ImportResult Database::addBooks(const QVector<Book> &books)
+{
+    ImportResult result;
+    QMutexLocker writeLock(DatabasePool::instance().writeLock());
+    
+    // One transaction and one prepared statement for the whole batch;
+    // duplicates are skipped by the primary key instead of a lookup per row
+    if (!beginWrite()) {
+        result.success = false;
+        return result;
+    }
+    
+    QSqlQuery query = statement(R"(
+        INSERT OR IGNORE INTO books (isbn, title, author, genre, year, checked_out)
+        VALUES (?, ?, ?, ?, ?, ?)
+    )");
+    
+    // Recorded as one statement per batch, with the rows it inserted
+    QueryTrace trace(m_database, query);
+    QStringList added;
+    for (const Book &book : books) {
+        query.bindValue(0, book.ISBN);
+        query.bindValue(1, book.title);
+        query.bindValue(2, book.author);
+        query.bindValue(3, book.genre);
+        query.bindValue(4, book.year);
+        query.bindValue(5, book.checkedOut);
+        
+        if (!trace.exec()) {
+            qDebug() << "Failed to import book:" << query.lastError().text();
+            m_database.rollback();
+            result = ImportResult();
+            result.success = false;
+            return result;
+        }
+        
+        if (query.numRowsAffected() > 0) {
+            result.inserted++;
+            added.append(book.ISBN);
+        } else {
+            result.skipped++;
+        }
+    }
+    
+    if (!commitWrite()) {
+        result = ImportResult();
+        result.success = false;
+        return result;
+    }
+    
+    if (IsbnFilter *filter = isbnFilter()) {
+        for (const QString &isbn : qAsConst(added)) {
+            filter->insert(isbn);
+        }
+        if (filter->needsRebuild()) {
+            rebuildIsbnFilter();
+        }
+    }
+    
+    return result;
+}
+
 bool Database::updateBook(const QString &isbn, const Book &book)
 {
-    QSqlQuery query;
-    query.prepare(R"(
+    QMutexLocker writeLock(DatabasePool::instance().writeLock());
+    Book before = getBookByISBN(isbn);
+    
+    QSqlQuery query = statement(R"(
         UPDATE books 
         SET title = ?, author = ?, genre = ?, year = ?, checked_out = ?, updated_at = CURRENT_TIMESTAMP
         WHERE isbn = ?
     )");
     
-    query.addBindValue(book.title);
-    query.addBindValue(book.author);
-    query.addBindValue(book.genre);
-    query.addBindValue(book.year);
-    query.addBindValue(book.checkedOut);
-    query.addBindValue(isbn);
+    query.bindValue(0, book.title);
+    query.bindValue(1, book.author);
+    query.bindValue(2, book.genre);
+    query.bindValue(3, book.year);
+    query.bindValue(4, book.checkedOut);
+    query.bindValue(5, isbn);
     
-    if (!query.exec()) {
+    if (!beginWrite()) {
+        return false;
+    }
+    
+    QueryTrace trace(m_database, query);
+    if (!trace.exec() || query.numRowsAffected() <= 0) {
         qDebug() << "Failed to update book:" << query.lastError().text();
+        m_database.rollback();
         return false;
     }
     
-    return query.numRowsAffected() > 0;
+    if (!commitWrite()) {
+        return false;
+    }
+    
+    Book after = book;
+    after.ISBN = isbn;
+    after.rowId = before.rowId;
+    emit bookUpdated(before, after);
+    
+    return true;
 }
 
 bool Database::removeBook(const QString &isbn)
 {
-    QSqlQuery query;
-    query.prepare("DELETE FROM books WHERE isbn = ?");
-    query.addBindValue(isbn);
+    QMutexLocker writeLock(DatabasePool::instance().writeLock());
+    Book removed = getBookByISBN(isbn);
+    
+    QSqlQuery query = statement("DELETE FROM books WHERE isbn = ?");
+    query.bindValue(0, isbn);
+    
+    if (!beginWrite()) {
+        return false;
+    }
     
-    if (!query.exec()) {
+    QueryTrace trace(m_database, query);
+    if (!trace.exec() || query.numRowsAffected() <= 0) {
         qDebug() << "Failed to remove book:" << query.lastError().text();
+        m_database.rollback();
+        return false;
+    }
+    
+    if (!commitWrite()) {
+        return false;
+    }
+    
+    // Still under the write lock, so no insert of the same ISBN can land
+    // between the delete and the decrement
+    if (IsbnFilter *filter = isbnFilter()) {
+        filter->remove(isbn);
+    }
+    
+    emit bookRemoved(removed);
+    
+    return true;
+}
+
+bool Database::checkoutBook(const QString &isbn, const QString &borrower, int loanDays)
+{
+    QMutexLocker writeLock(DatabasePool::instance().writeLock());
+    Book before = getBookByISBN(isbn);
+    if (before.ISBN.isEmpty() || before.checkedOut) {
+        return false;
+    }
+    
+    if (!beginWrite()) {
         return false;
     }
     
-    return query.numRowsAffected() > 0;
+    QSqlQuery query = statement(R"(
+        INSERT INTO loans (isbn, borrower, checked_out_at, due_at)
+        VALUES (?, ?, datetime('now'), datetime('now', ?))
+    )");
+    query.bindValue(0, isbn);
+    query.bindValue(1, borrower);
+    query.bindValue(2, QString("+%1 days").arg(loanDays));
+    
+    QueryTrace trace(m_database, query);
+    if (!trace.exec() || !setCheckedOut(isbn, true)) {
+        qDebug() << "Failed to check out book:" << query.lastError().text();
+        m_database.rollback();
+        return false;
+    }
+    if (!commitWrite()) {
+        return false;
+    }
+    
+    Book after = before;
+    after.checkedOut = true;
+    emit bookUpdated(before, after);
+    
+    return true;
+}
+
+bool Database::returnBook(const QString &isbn, Loan *closedLoan)
+{
+    QMutexLocker writeLock(DatabasePool::instance().writeLock());
+    Book before = getBookByISBN(isbn);
+    if (before.ISBN.isEmpty() || !before.checkedOut) {
+        return false;
+    }
+    
+    // Books checked out before loans were recorded have no open loan;
+    // they are still returned
+    Loan loan = currentLoan(isbn);
+    
+    if (!beginWrite()) {
+        return false;
+    }
+    
+    QSqlQuery query = statement("UPDATE loans SET returned_at = datetime('now') WHERE isbn = ? AND returned_at IS NULL");
+    query.bindValue(0, isbn);
+    
+    QueryTrace trace(m_database, query);
+    if (!trace.exec() || !setCheckedOut(isbn, false)) {
+        qDebug() << "Failed to return book:" << query.lastError().text();
+        m_database.rollback();
+        return false;
+    }
+    if (!commitWrite()) {
+        return false;
+    }
+    
+    if (closedLoan) {
+        loan.returnedAt = QDateTime::currentDateTimeUtc();
+        *closedLoan = loan;
+    }
+    
+    Book after = before;
+    after.checkedOut = false;
+    emit bookUpdated(before, after);
+    
+    return true;
+}
+
+bool Database::setCheckedOut(const QString &isbn, bool checkedOut)
+{
+    QSqlQuery query = statement("UPDATE books SET checked_out = ?, updated_at = CURRENT_TIMESTAMP WHERE isbn = ?");
+    query.bindValue(0, checkedOut);
+    query.bindValue(1, isbn);
+    
+    QueryTrace trace(m_database, query);
+    return trace.exec() && query.numRowsAffected() > 0;
+}
+
+Loan Database::currentLoan(const QString &isbn)
+{
+    QVector<Loan> open = loans(R"(
+        SELECT l.id, l.isbn, '', l.borrower, l.checked_out_at, l.due_at, l.returned_at
+        FROM loans l WHERE l.isbn = ? AND l.returned_at IS NULL
+    )", {isbn});
+    return open.isEmpty() ? Loan() : open.first();
+}
+
+QVector<Loan> Database::overdueLoans(int limit)
+{
+    return loans("SELECT * FROM overdue_loans ORDER BY due_at LIMIT ?", {limit});
+}
+
+QVector<Loan> Database::loansForBorrower(const QString &borrower, int limit)
+{
+    return loans("SELECT * FROM loans_by_borrower WHERE borrower = ? ORDER BY checked_out_at DESC LIMIT ?",
+                 {borrower, limit});
+}
+
+QVector<Loan> Database::loanHistory(const QString &isbn, int limit)
+{
+    return loans("SELECT * FROM book_loan_history WHERE isbn = ? ORDER BY checked_out_at DESC LIMIT ?",
+                 {isbn, limit});
+}
+
+QVector<Loan> Database::loans(const QString &sql, const QVariantList &values)
+{
+    QVector<Loan> result;
+    QSqlQuery query = statement(sql);
+    for (int i = 0; i < values.size(); ++i) {
+        query.bindValue(i, values[i]);
+    }
+    
+    QueryTrace trace(m_database, query);
+    if (!trace.exec()) {
+        qDebug() << "Failed to read loans:" << query.lastError().text();
+        return result;
+    }
+    
+    while (trace.next()) {
+        result.append(loanFromQuery(query));
+    }
+    query.finish();
+    
+    return result;
 }
 
 QVector<Book> Database::getAllBooks()
 {
     QVector<Book> books;
-    QSqlQuery query("SELECT isbn, title, author, genre, year, checked_out FROM books ORDER BY title");
+    QSqlQuery query = statement("SELECT isbn, title, author, genre, year, checked_out, rowid FROM books ORDER BY title");
     
-    while (query.next()) {
-        Book book;
-        book.ISBN = query.value(0).toString();
-        book.title = query.value(1).toString();
-        book.author = query.value(2).toString();
-        book.genre = query.value(3).toString();
-        book.year = query.value(4).toInt();
-        book.checkedOut = query.value(5).toBool();
-        books.append(book);
+    QueryTrace trace(m_database, query);
+    if (!trace.exec()) {
+        qDebug() << "Failed to load books:" << query.lastError().text();
+        return books;
+    }
+    
+    while (trace.next()) {
+        books.append(bookFromQuery(query));
     }
+    query.finish();
+    
+    return books;
+}
+
+bool Database::forEachBook(const std::function<bool(const Book &)> &visit)
+{
+    // Rowid order walks the table itself, so no sort buffer is needed
+    QSqlQuery query = statement("SELECT isbn, title, author, genre, year, checked_out, rowid FROM books ORDER BY rowid");
+    
+    QueryTrace trace(m_database, query);
+    if (!trace.exec()) {
+        qDebug() << "Failed to read books:" << query.lastError().text();
+        return false;
+    }
+    
+    while (trace.next()) {
+        if (!visit(bookFromQuery(query))) {
+            break;
+        }
+    }
+    query.finish();
+    
+    return true;
+}
+
+QVector<Book> Database::getBooksPage(const BookSortKey &after, int limit,
+                                     BookSortColumn column, Qt::SortOrder order,
+                                     const BookSortKey &upTo)
+{
+    // Keyset pagination: seek past the last row of the previous page on the
+    // column's index (which carries the rowid) instead of skipping rows
+    // with OFFSET, so every page costs the same however deep it is
+    static const char *const columns[] = {"title", "author", "isbn", "genre", "year", "checked_out"};
+    QString name = columns[column];
+    bool descending = order == Qt::DescendingOrder;
+    
+    QStringList conditions;
+    if (after.valid) {
+        conditions << QString("(%1, rowid) %2 (?, ?)").arg(name, descending ? "<" : ">");
+    }
+    if (upTo.valid) {
+        conditions << QString("(%1, rowid) %2 (?, ?)").arg(name, descending ? ">=" : "<=");
+    }
+    
+    QString sql = "SELECT isbn, title, author, genre, year, checked_out, rowid FROM books ";
+    if (!conditions.isEmpty()) {
+        sql += "WHERE " + conditions.join(" AND ") + " ";
+    }
+    sql += descending ? QString("ORDER BY %1 DESC, rowid DESC LIMIT ?").arg(name)
+                      : QString("ORDER BY %1, rowid LIMIT ?").arg(name);
+    
+    QVector<Book> books;
+    QSqlQuery query = statement(sql);
+    
+    int index = 0;
+    if (after.valid) {
+        query.bindValue(index++, after.value);
+        query.bindValue(index++, after.rowId);
+    }
+    if (upTo.valid) {
+        query.bindValue(index++, upTo.value);
+        query.bindValue(index++, upTo.rowId);
+    }
+    query.bindValue(index, limit);
+    
+    QueryTrace trace(m_database, query);
+    if (!trace.exec()) {
+        qDebug() << "Failed to load page:" << query.lastError().text();
+        return books;
+    }
+    
+    if (limit > 0) {
+        books.reserve(limit);
+    }
+    while (trace.next()) {
+        books.append(bookFromQuery(query));
+    }
+    query.finish();
     
     return books;
 }
@@ -176,37 +768,58 @@ QVector<Book> Database::getAllBooks()
 QVector<Book> Database::searchBooks(const QString &query)
 {
     QVector<Book> books;
-    QSqlQuery sqlQuery;
     
-    QString searchSQL = R"(
-        SELECT isbn, title, author, genre, year, checked_out 
+    QString match = m_hasFullText ? toFullTextQuery(query) : QString();
+    if (!match.isEmpty()) {
+        // Title matches rank above author, ISBN and genre matches
+        QSqlQuery ftsQuery = statement(R"(
+            SELECT b.isbn, b.title, b.author, b.genre, b.year, b.checked_out, b.rowid
+            FROM books_fts JOIN books b ON b.rowid = books_fts.rowid
+            WHERE books_fts MATCH ?
+            ORDER BY bm25(books_fts, 10.0, 5.0, 2.0, 1.0), b.title
+            LIMIT ?
+        )");
+        ftsQuery.bindValue(0, match);
+        ftsQuery.bindValue(1, MaxSearchResults);
+        
+        QueryTrace trace(m_database, ftsQuery);
+        if (!trace.exec()) {
+            qDebug() << "Search failed:" << ftsQuery.lastError().text();
+            return books;
+        }
+        
+        while (trace.next()) {
+            books.append(bookFromQuery(ftsQuery));
+        }
+        ftsQuery.finish();
+        
+        return books;
+    }
+    
+    QSqlQuery sqlQuery = statement(R"(
+        SELECT isbn, title, author, genre, year, checked_out, rowid
         FROM books 
         WHERE title LIKE ? OR author LIKE ? OR isbn LIKE ? OR genre LIKE ?
         ORDER BY title
-    )";
+        LIMIT ?
+    )");
     
-    sqlQuery.prepare(searchSQL);
     QString searchPattern = "%" + query + "%";
-    sqlQuery.addBindValue(searchPattern);
-    sqlQuery.addBindValue(searchPattern);
-    sqlQuery.addBindValue(searchPattern);
-    sqlQuery.addBindValue(searchPattern);
+    for (int i = 0; i < 4; ++i) {
+        sqlQuery.bindValue(i, searchPattern);
+    }
+    sqlQuery.bindValue(4, MaxSearchResults);
     
-    if (!sqlQuery.exec()) {
+    QueryTrace trace(m_database, sqlQuery);
+    if (!trace.exec()) {
         qDebug() << "Search failed:" << sqlQuery.lastError().text();
         return books;
     }
     
-    while (sqlQuery.next()) {
-        Book book;
-        book.ISBN = sqlQuery.value(0).toString();
-        book.title = sqlQuery.value(1).toString();
-        book.author = sqlQuery.value(2).toString();
-        book.genre = sqlQuery.value(3).toString();
-        book.year = sqlQuery.value(4).toInt();
-        book.checkedOut = sqlQuery.value(5).toBool();
-        books.append(book);
+    while (trace.next()) {
+        books.append(bookFromQuery(sqlQuery));
     }
+    sqlQuery.finish();
     
     return books;
 }
@@ -214,60 +827,111 @@ QVector<Book> Database::searchBooks(const QString &query)
 Book Database::getBookByISBN(const QString &isbn)
 {
     Book book;
-    QSqlQuery query;
-    query.prepare("SELECT isbn, title, author, genre, year, checked_out FROM books WHERE isbn = ?");
-    query.addBindValue(isbn);
+    QSqlQuery query = statement("SELECT isbn, title, author, genre, year, checked_out, rowid FROM books WHERE isbn = ?");
+    query.bindValue(0, isbn);
     
-    if (query.exec() && query.next()) {
-        book.ISBN = query.value(0).toString();
-        book.title = query.value(1).toString();
-        book.author = query.value(2).toString();
-        book.genre = query.value(3).toString();
-        book.year = query.value(4).toInt();
-        book.checkedOut = query.value(5).toBool();
+    QueryTrace trace(m_database, query);
+    if (trace.exec() && trace.next()) {
+        book = bookFromQuery(query);
     }
+    query.finish();
     
     return book;
 }
 
 bool Database::bookExists(const QString &isbn)
 {
-    QSqlQuery query;
-    query.prepare("SELECT COUNT(*) FROM books WHERE isbn = ?");
-    query.addBindValue(isbn);
+    // Most ISBNs checked are new; the filter answers those without a query
+    IsbnFilter *filter = isbnFilter();
+    if (filter && !filter->mightContain(isbn)) {
+        return false;
+    }
+    
+    // A row only when the book exists, so the trace counts what was found
+    QSqlQuery query = statement("SELECT 1 FROM books WHERE isbn = ? LIMIT 1");
+    query.bindValue(0, isbn);
+    
+    QueryTrace trace(m_database, query);
+    bool exists = trace.exec() && trace.next();
+    query.finish();
     
-    if (query.exec() && query.next()) {
-        return query.value(0).toInt() > 0;
+    if (!exists && filter) {
+        filter->recordFalsePositive();
+    }
+    return exists;
+}
+
+bool Database::loadIsbnFilter()
+{
+    QMutexLocker writeLock(DatabasePool::instance().writeLock());
+    return rebuildIsbnFilter();
+}
+
+bool Database::rebuildIsbnFilter()
+{
+    // Callers hold the write lock, so no insert can slip in between the
+    // scan and the swap
+    IsbnFilter *filter = isbnFilter();
+    if (!filter) {
+        return false;
     }
     
-    return false;
+    QElapsedTimer timer;
+    timer.start();
+    
+    IsbnFilter::Builder builder(getTotalBooks());
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+    QueryTrace trace(m_database, query);
+    if (!trace.exec("SELECT isbn FROM books")) {
+        qDebug() << "Failed to load ISBN filter:" << query.lastError().text();
+        return false;
+    }
+    
+    qint64 rows = 0;
+    while (trace.next()) {
+        builder.insert(query.value(0).toString());
+        rows++;
+    }
+    query.finish();
+    
+    filter->load(builder);
+    qDebug() << "Loaded ISBN filter with" << rows << "entries in" << timer.elapsed() << "ms";
+    return true;
 }
 
 int Database::getTotalBooks()
 {
-    QSqlQuery query("SELECT COUNT(*) FROM books");
-    if (query.exec() && query.next()) {
-        return query.value(0).toInt();
-    }
-    return 0;
+    return scalar("SELECT COUNT(*) FROM books").toInt();
 }
 
 int Database::getAvailableBooks()
 {
-    QSqlQuery query("SELECT COUNT(*) FROM books WHERE checked_out = 0");
-    if (query.exec() && query.next()) {
-        return query.value(0).toInt();
-    }
-    return 0;
+    return scalar("SELECT COUNT(*) FROM books WHERE checked_out = 0").toInt();
 }
 
 int Database::getCheckedOutBooks()
 {
-    QSqlQuery query("SELECT COUNT(*) FROM books WHERE checked_out = 1");
-    if (query.exec() && query.next()) {
-        return query.value(0).toInt();
+    return scalar("SELECT COUNT(*) FROM books WHERE checked_out = 1").toInt();
+}
+
+LibraryStatistics Database::getStatistics()
+{
+    LibraryStatistics stats;
+    QSqlQuery query = statement(R"(
+        SELECT COUNT(*), COALESCE(SUM(checked_out = 0), 0), COALESCE(SUM(checked_out = 1), 0)
+        FROM books
+    )");
+    
+    QueryTrace trace(m_database, query);
+    if (trace.exec() && trace.next()) {
+        stats.total = query.value(0).toInt();
+        stats.available = query.value(1).toInt();
+        stats.checkedOut = query.value(2).toInt();
     }
-    return 0;
+    query.finish();
+    
+    return stats;
 }
 
 double Database::getAvailabilityRate()
@@ -278,3 +942,240 @@ double Database::getAvailabilityRate()
     int available = getAvailableBooks();
     return (double)available / total * 100.0;
 }
+
+qint64 Database::changePosition()
+{
+    return scalar("SELECT COALESCE(MAX(seq), 0) FROM book_changes").toLongLong();
+}
+
+qint64 Database::dataVersion()
+{
+    return scalar("PRAGMA data_version").toLongLong();
+}
+
+QVector<BookChange> Database::changesSince(qint64 position, int limit)
+{
+    QVector<BookChange> changes;
+    QSqlQuery query = statement("SELECT seq, isbn, operation FROM book_changes WHERE seq > ? ORDER BY seq LIMIT ?");
+    query.bindValue(0, position);
+    query.bindValue(1, limit);
+    
+    QueryTrace trace(m_database, query);
+    if (!trace.exec()) {
+        qDebug() << "Failed to read change log:" << query.lastError().text();
+        return changes;
+    }
+    
+    while (trace.next()) {
+        BookChange change;
+        change.sequence = query.value(0).toLongLong();
+        change.isbn = query.value(1).toString();
+        change.operation = query.value(2).toString().at(0);
+        changes.append(change);
+    }
+    query.finish();
+    
+    return changes;
+}
+
+bool Database::pruneChanges(int retentionHours)
+{
+    QMutexLocker writeLock(DatabasePool::instance().writeLock());
+    
+    // The newest row always stays so that MAX(seq), and with it the
+    // change position, never moves backwards
+    QSqlQuery query = statement(R"(
+        DELETE FROM book_changes
+        WHERE changed_at < datetime('now', ?)
+          AND seq < (SELECT MAX(seq) FROM book_changes)
+    )");
+    query.bindValue(0, QString("-%1 hours").arg(retentionHours));
+    
+    QueryTrace trace(m_database, query);
+    if (!trace.exec()) {
+        qDebug() << "Failed to prune change log:" << query.lastError().text();
+        return false;
+    }
+    
+    int removed = query.numRowsAffected();
+    if (removed > 0) {
+        qDebug() << "Pruned" << removed << "change log entries";
+    }
+    return true;
+}
+
+IsbnFilter *Database::isbnFilter() const
+{
+    // The filter describes the pool's database; connections to other
+    // files (benchmarks, tools) do without it
+    return isPoolDatabase() ? DatabasePool::instance().isbnFilter() : nullptr;
+}
+
+bool Database::isPoolDatabase() const
+{
+    return m_database.databaseName() == DatabasePool::instance().path();
+}
+
+bool Database::beginWrite()
+{
+    // IMMEDIATE takes SQLite's write lock now instead of at the first
+    // write, so every journal row added until commitWrite() is our own
+    QSqlQuery begin(m_database);
+    if (!begin.exec("BEGIN IMMEDIATE")) {
+        qDebug() << "Failed to start write transaction:" << begin.lastError().text();
+        return false;
+    }
+    m_writeStart = changePosition();
+    return true;
+}
+
+bool Database::commitWrite()
+{
+    // Registered before commit so the change monitor cannot see the rows
+    // first; withdrawn again if they never land
+    qint64 end = changePosition();
+    bool pooled = isPoolDatabase() && end > m_writeStart;
+    if (pooled) {
+        DatabasePool::instance().addOwnChanges(m_writeStart, end);
+    }
+    
+    if (!m_database.commit()) {
+        qDebug() << "Failed to commit:" << m_database.lastError().text();
+        m_database.rollback();
+        if (pooled) {
+            DatabasePool::instance().removeOwnChanges(m_writeStart, end);
+        }
+        return false;
+    }
+    return true;
+}
+
+QSqlQuery Database::statement(const QString &sql)
+{
+    // Prepared once per connection; callers rebind and re-execute. QSqlQuery
+    // copies share the same underlying statement handle.
+    auto it = m_statements.constFind(sql);
+    if (it != m_statements.constEnd()) {
+        return it.value();
+    }
+    
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+    if (!query.prepare(sql)) {
+        qDebug() << "Failed to prepare statement:" << query.lastError().text();
+        return query;
+    }
+    
+    m_statements.insert(sql, query);
+    return query;
+}
+
+QVariant Database::scalar(const QString &sql)
+{
+    QSqlQuery query = statement(sql);
+    QueryTrace trace(m_database, query);
+    QVariant value;
+    if (trace.exec() && trace.next()) {
+        value = query.value(0);
+    }
+    query.finish();
+    return value;
+}
+
+Loan Database::loanFromQuery(const QSqlQuery &query)
+{
+    // Columns: id, isbn, title, borrower, checked_out_at, due_at, returned_at
+    auto timestamp = [&query](int column) {
+        QVariant value = query.value(column);
+        if (value.isNull()) {
+            return QDateTime();
+        }
+        QDateTime time = QDateTime::fromString(value.toString(), "yyyy-MM-dd HH:mm:ss");
+        time.setTimeSpec(Qt::UTC);
+        return time;
+    };
+    
+    Loan loan;
+    loan.id = query.value(0).toLongLong();
+    loan.isbn = query.value(1).toString();
+    loan.title = query.value(2).toString();
+    loan.borrower = query.value(3).toString();
+    loan.checkedOutAt = timestamp(4);
+    loan.dueAt = timestamp(5);
+    loan.returnedAt = timestamp(6);
+    return loan;
+}
+
+Book Database::bookFromQuery(const QSqlQuery &query)
+{
+    Book book;
+    book.ISBN = query.value(0).toString();
+    book.title = query.value(1).toString();
+    book.author = query.value(2).toString();
+    book.genre = query.value(3).toString();
+    book.year = query.value(4).toInt();
+    book.checkedOut = query.value(5).toBool();
+    book.rowId = query.value(6).toLongLong();
+    return book;
+}
+
+bool Database::matchesSearch(const Book &book, const QString &query) const
+{
+    // In-memory equivalent of searchBooks() for unquoted queries
+    const QStringList fields = {book.title, book.author, book.ISBN, book.genre};
+    
+    if (!m_hasFullText) {
+        for (const QString &field : fields) {
+            if (field.contains(query, Qt::CaseInsensitive)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    QStringList tokens;
+    for (const QString &field : fields) {
+        tokens += foldForSearch(field).split(wordSeparators(), Qt::SkipEmptyParts);
+    }
+    
+    const QStringList words = foldForSearch(query).split(wordSeparators(), Qt::SkipEmptyParts);
+    for (const QString &word : words) {
+        bool found = false;
+        for (const QString &token : tokens) {
+            if (token.startsWith(word)) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QString Database::toFullTextQuery(const QString &query)
+{
+    // "quoted text" is matched as a phrase, every other word as a prefix;
+    // all terms must match. Terms are re-quoted so FTS5 operators in user
+    // input are treated as plain text.
+    QStringList terms;
+    QStringList parts = query.split('"');
+    
+    for (int i = 0; i < parts.size(); ++i) {
+        if (i % 2 == 1) {
+            QString phrase = parts[i].simplified();
+            if (!phrase.isEmpty()) {
+                terms.append('"' + phrase + '"');
+            }
+            continue;
+        }
+        
+        const QStringList words = parts[i].split(wordSeparators(), Qt::SkipEmptyParts);
+        for (const QString &word : words) {
+            terms.append('"' + word + "\"*");
+        }
+    }
+    
+    return terms.join(' ');
+}
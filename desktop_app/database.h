@@ -3,13 +3,18 @@
 
 #include <QObject>
 #include <QVector>
+#include <QHash>
 #include <QString>
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QStandardPaths>
 #include <QDir>
+#include <QDateTime>
 #include <QDebug>
+#include <functional>
+
+class IsbnFilter;
 
 struct Book {
     QString title;
@@ -18,10 +23,76 @@ struct Book {
     QString genre;
     int year;
     bool checkedOut;
+    qint64 rowId; // SQLite rowid, 0 if not loaded from the database
     
-    Book() : year(0), checkedOut(false) {}
+    Book() : year(0), checkedOut(false), rowId(0) {}
     Book(const QString &t, const QString &a, const QString &i, const QString &g, int y, bool co = false)
-        : title(t), author(a), ISBN(i), genre(g), year(y), checkedOut(co) {}
+        : title(t), author(a), ISBN(i), genre(g), year(y), checkedOut(co), rowId(0) {}
+    
+    // ISBN-10/13 checksum; non-digit characters such as hyphens are ignored
+    static bool isValidISBN(const QString &isbn);
+};
+
+// Sortable catalog columns, in BookModel column order
+enum BookSortColumn {
+    SortByTitle,
+    SortByAuthor,
+    SortByIsbn,
+    SortByGenre,
+    SortByYear,
+    SortByStatus
+};
+
+// Position in the catalog sort order, used for keyset pagination
+struct BookSortKey {
+    QVariant value;
+    qint64 rowId;
+    bool valid;
+    
+    BookSortKey() : rowId(0), valid(false) {}
+    BookSortKey(const QVariant &v, qint64 id) : value(v), rowId(id), valid(true) {}
+};
+
+// One entry of the catalog mutation log, in commit order
+struct BookChange {
+    qint64 sequence;
+    QString isbn;
+    QChar operation; // 'I'nsert, 'U'pdate or 'D'elete
+    
+    BookChange() : sequence(0) {}
+};
+
+// Outcome of a bulk import
+struct ImportResult {
+    int inserted;
+    int skipped; // ISBN already in the catalog
+    bool success;
+    
+    ImportResult() : inserted(0), skipped(0), success(true) {}
+};
+
+struct LibraryStatistics {
+    int total;
+    int available;
+    int checkedOut;
+    
+    LibraryStatistics() : total(0), available(0), checkedOut(0) {}
+    double availabilityRate() const { return total > 0 ? (double)available / total * 100.0 : 0.0; }
+};
+
+// One checkout of a book; returnedAt is null while the loan is open
+struct Loan {
+    qint64 id;
+    QString isbn;
+    QString title;
+    QString borrower;
+    QDateTime checkedOutAt;
+    QDateTime dueAt;
+    QDateTime returnedAt;
+    
+    Loan() : id(0) {}
+    bool isOpen() const { return returnedAt.isNull(); }
+    bool isOverdue() const { return isOpen() && dueAt < QDateTime::currentDateTimeUtc(); }
 };
 
 class Database : public QObject
@@ -31,30 +102,113 @@ class Database : public QObject
 public:
     static Database& instance();
     
-    bool initialize();
+    // Additional connections (e.g. for worker threads) use their own name
+    explicit Database(const QString &connectionName, QObject *parent = nullptr);
+    
+    enum OpenMode { ReadWrite, ReadOnly };
+    
+    static QString defaultPath();
+    bool open(const QString &path, OpenMode mode = ReadWrite);
+    void close();
+    bool initialize(const QString &path = defaultPath());
+    // Creates or upgrades the schema unless PRAGMA user_version already
+    // says it is current; bump SchemaVersion with every schema change
+    static const int SchemaVersion = 1;
+    bool ensureSchema();
     bool addBook(const Book &book);
+    ImportResult addBooks(const QVector<Book> &books);
     bool updateBook(const QString &isbn, const Book &book);
     bool removeBook(const QString &isbn);
+    
+    // Circulation: checkout opens a loan and marks the book checked out,
+    // return closes the open loan; both in one transaction
+    static const int DefaultLoanDays = 14;
+    bool checkoutBook(const QString &isbn, const QString &borrower, int loanDays = DefaultLoanDays);
+    bool returnBook(const QString &isbn, Loan *closedLoan = nullptr);
+    Loan currentLoan(const QString &isbn);
+    QVector<Loan> overdueLoans(int limit = 100);
+    QVector<Loan> loansForBorrower(const QString &borrower, int limit = 100);
+    QVector<Loan> loanHistory(const QString &isbn, int limit = 100);
+    
     QVector<Book> getAllBooks();
+    // Streams every book through visit() from a forward-only cursor
+    // without materialising the catalog; visit() returns false to stop
+    bool forEachBook(const std::function<bool(const Book &)> &visit);
+    // Rows after `after`, and no further than `upTo` when that is valid;
+    // a negative limit reads the whole range
+    QVector<Book> getBooksPage(const BookSortKey &after, int limit,
+                               BookSortColumn column = SortByTitle,
+                               Qt::SortOrder order = Qt::AscendingOrder,
+                               const BookSortKey &upTo = BookSortKey());
+    // Best matches first; anything past MaxSearchResults is left out
+    static const int MaxSearchResults = 500;
     QVector<Book> searchBooks(const QString &query);
+    bool hasFullTextSearch() const { return m_hasFullText; }
+    bool matchesSearch(const Book &book, const QString &query) const;
     Book getBookByISBN(const QString &isbn);
+    // Consults the pool's ISBN filter first and only queries on a possible
+    // hit. Books added by other clients are in the filter once the change
+    // monitor has seen them; until then the primary key still rejects them.
     bool bookExists(const QString &isbn);
+    // Streams every ISBN into a fresh filter and swaps it in
+    bool loadIsbnFilter();
     
     // Statistics
+    LibraryStatistics getStatistics();
     int getTotalBooks();
     int getAvailableBooks();
     int getCheckedOutBooks();
     double getAvailabilityRate();
+    
+    // Change journal: sequence of the newest row, 0 when empty. Every
+    // process sharing the file reads the same database directly; the
+    // journal only tells them which books to refresh in their views.
+    qint64 changePosition();
+    // Changes whenever another connection, in this process or another,
+    // commits to the database file; cheap enough to poll
+    qint64 dataVersion();
+    QVector<BookChange> changesSince(qint64 position, int limit = 1000);
+    // Deletes journal rows older than this; a client that had not read
+    // them yet finds the gap and reloads
+    bool pruneChanges(int retentionHours);
+
+signals:
+    // Emitted after single-book writes made through this connection
+    void bookAdded(const Book &book);
+    void bookUpdated(const Book &before, const Book &after);
+    void bookRemoved(const Book &book);
 
 private:
-    Database() = default;
-    ~Database() = default;
+    Database();
     Database(const Database&) = delete;
     Database& operator=(const Database&) = delete;
     
+    QString m_connectionName;
     QSqlDatabase m_database;
+    QHash<QString, QSqlQuery> m_statements;
+    bool m_hasFullText = false;
+    qint64 m_writeStart = 0;
+    
     bool createTables();
+    void createFullTextIndex();
     void insertSampleData();
+    QSqlQuery statement(const QString &sql);
+    QVariant scalar(const QString &sql);
+    static Book bookFromQuery(const QSqlQuery &query);
+    static Loan loanFromQuery(const QSqlQuery &query);
+    QVector<Loan> loans(const QString &sql, const QVariantList &values);
+    bool setCheckedOut(const QString &isbn, bool checkedOut);
+    bool rebuildIsbnFilter();
+    IsbnFilter *isbnFilter() const;
+    bool isPoolDatabase() const;
+    // Write transactions whose journal rows the change monitor skips
+    bool beginWrite();
+    bool commitWrite();
+    static QString toFullTextQuery(const QString &query);
 };
 
+Q_DECLARE_METATYPE(Book)
+Q_DECLARE_METATYPE(LibraryStatistics)
+Q_DECLARE_METATYPE(Loan)
+
 #endif // DATABASE_H
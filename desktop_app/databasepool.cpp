@@ -0,0 +1,131 @@
+#include "databasepool.h"
+#include <QCoreApplication>
+#include <QThread>
+#include <algorithm>
+
+DatabasePool& DatabasePool::instance()
+{
+    static DatabasePool instance;
+    return instance;
+}
+
+void DatabasePool::setPath(const QString &path)
+{
+    QMutexLocker locker(&m_pathLock);
+    if (m_path != path) {
+        m_isbnFilter.clear();
+        QMutexLocker ownChangesLocker(&m_ownChangesLock);
+        m_ownChanges.clear();
+    }
+    m_path = path;
+}
+
+void DatabasePool::addOwnChanges(qint64 after, qint64 last)
+{
+    QMutexLocker locker(&m_ownChangesLock);
+    m_ownChanges.append(qMakePair(after, last));
+}
+
+void DatabasePool::removeOwnChanges(qint64 after, qint64 last)
+{
+    QMutexLocker locker(&m_ownChangesLock);
+    m_ownChanges.removeAll(qMakePair(after, last));
+}
+
+bool DatabasePool::isOwnChange(qint64 sequence) const
+{
+    QMutexLocker locker(&m_ownChangesLock);
+    for (const QPair<qint64, qint64> &range : m_ownChanges) {
+        if (sequence > range.first && sequence <= range.second) {
+            return true;
+        }
+    }
+    return false;
+}
+
+qint64 DatabasePool::skipOwnChanges(qint64 position) const
+{
+    QMutexLocker locker(&m_ownChangesLock);
+    bool moved = true;
+    while (moved) {
+        moved = false;
+        for (const QPair<qint64, qint64> &range : m_ownChanges) {
+            if (range.first <= position && position < range.second) {
+                position = range.second;
+                moved = true;
+            }
+        }
+    }
+    return position;
+}
+
+void DatabasePool::forgetOwnChanges(qint64 position)
+{
+    QMutexLocker locker(&m_ownChangesLock);
+    auto readPast = [position](const QPair<qint64, qint64> &range) { return range.second <= position; };
+    m_ownChanges.erase(std::remove_if(m_ownChanges.begin(), m_ownChanges.end(), readPast), m_ownChanges.end());
+}
+
+QString DatabasePool::path() const
+{
+    QMutexLocker locker(&m_pathLock);
+    return m_path;
+}
+
+Database *DatabasePool::reader()
+{
+    ThreadConnections *thread = connections();
+    if (!thread->reader) {
+        thread->reader = new Database(connectionName("reader"));
+        if (!thread->reader->open(path(), Database::ReadOnly)) {
+            qDebug() << "Failed to open read-only connection for" << QThread::currentThread();
+        }
+    }
+    return thread->reader;
+}
+
+Database *DatabasePool::writer()
+{
+    ThreadConnections *thread = connections();
+    if (!thread->writer) {
+        thread->writer = new Database(connectionName("writer"));
+        if (!thread->writer->open(path())) {
+            qDebug() << "Failed to open writer connection for" << QThread::currentThread();
+        }
+    }
+    return thread->writer;
+}
+
+DatabasePool::ThreadConnections *DatabasePool::connections()
+{
+    // Deleted (and the connections closed) when the owning thread exits
+    if (!m_connections.hasLocalData()) {
+        m_connections.setLocalData(new ThreadConnections);
+    }
+    
+    ThreadConnections *thread = m_connections.localData();
+    QString current = path();
+    if (thread->path != current) {
+        thread->close();
+        thread->path = current;
+    }
+    return thread;
+}
+
+QString DatabasePool::connectionName(const char *role) const
+{
+    return QString("library-%1-%2").arg(role).arg(quintptr(QThread::currentThreadId()), 0, 16);
+}
+
+void DatabasePool::ThreadConnections::close()
+{
+    // Connection bookkeeping is gone once the application has shut down
+    for (Database *database : {reader, writer}) {
+        if (database && QCoreApplication::instance()) {
+            database->close();
+        }
+        delete database;
+    }
+    reader = nullptr;
+    writer = nullptr;
+}
@@ -0,0 +1,69 @@
+#ifndef DATABASEPOOL_H
+#define DATABASEPOOL_H
+
+#include <QMutex>
+#include <QPair>
+#include <QVector>
+#include <QString>
+#include <QThreadStorage>
+#include "database.h"
+#include "isbnfilter.h"
+
+// Hands out per-thread connections to the library database, since a Qt
+// SQL connection may only be used by the thread that opened it. Each
+// thread gets a read-only connection for queries and, if it writes, a
+// read-write connection. SQLite allows one writer at a time, so writers
+// hold writeLock() for the duration of their write transaction; readers
+// never wait for it thanks to WAL mode.
+class DatabasePool
+{
+public:
+    static DatabasePool& instance();
+    
+    // Connections opened for an earlier path are reopened on next use
+    void setPath(const QString &path);
+    QString path() const;
+    
+    Database *reader();
+    Database *writer();
+    QMutex *writeLock() { return &m_writeLock; }
+    // Shared by every connection to the current path; emptied when the
+    // path changes until Database::loadIsbnFilter() runs
+    IsbnFilter *isbnFilter() { return &m_isbnFilter; }
+    
+    // Change journal sequences (after, last] written by this process. Their
+    // signals have already gone out, so the change monitor skips them.
+    void addOwnChanges(qint64 after, qint64 last);
+    void removeOwnChanges(qint64 after, qint64 last);
+    bool isOwnChange(qint64 sequence) const;
+    // Moves position past any own range it falls in
+    qint64 skipOwnChanges(qint64 position) const;
+    // Drops ranges the change monitor has read past
+    void forgetOwnChanges(qint64 position);
+
+private:
+    DatabasePool() = default;
+    DatabasePool(const DatabasePool&) = delete;
+    DatabasePool& operator=(const DatabasePool&) = delete;
+    
+    struct ThreadConnections {
+        QString path;
+        Database *reader = nullptr;
+        Database *writer = nullptr;
+        void close();
+        ~ThreadConnections() { close(); }
+    };
+    
+    ThreadConnections *connections();
+    QString connectionName(const char *role) const;
+    
+    mutable QMutex m_pathLock;
+    QString m_path;
+    QMutex m_writeLock;
+    IsbnFilter m_isbnFilter;
+    mutable QMutex m_ownChangesLock;
+    QVector<QPair<qint64, qint64>> m_ownChanges;
+    QThreadStorage<ThreadConnections *> m_connections;
+};
+
+#endif // DATABASEPOOL_H
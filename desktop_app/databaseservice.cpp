@@ -0,0 +1,303 @@
+#include "databaseservice.h"
+#include "databasepool.h"
+#include <QMetaObject>
+#include <QSet>
+#include <QTimer>
+
+DatabaseService::DatabaseService(const QString &databasePath, QObject *parent)
+    : QObject(parent)
+    , m_nextRequestId(0)
+    , m_currentSearchId(0)
+    , m_dataVersion(0)
+    , m_syncPosition(0)
+{
+    qRegisterMetaType<Book>();
+    qRegisterMetaType<QVector<Book>>();
+    qRegisterMetaType<LibraryStatistics>();
+    qRegisterMetaType<Loan>();
+    qRegisterMetaType<QVector<Loan>>();
+    qRegisterMetaType<QStringList>();
+    
+    DatabasePool::instance().setPath(databasePath);
+    m_readContext = startThread(m_readThread, "DatabaseReader");
+    m_writeContext = startThread(m_writeThread, "DatabaseWriter");
+    
+    post(m_writeContext, [this]() {
+        Database *writer = DatabasePool::instance().writer();
+        bool success = writer->ensureSchema();
+        connect(writer, &Database::bookAdded, this, &DatabaseService::bookAdded);
+        connect(writer, &Database::bookUpdated, this, &DatabaseService::bookUpdated);
+        connect(writer, &Database::bookRemoved, this, &DatabaseService::bookRemoved);
+        
+        // Readers need the tables to exist. The monitor starts from before
+        // the filter is loaded, so no insert can fall between the two.
+        if (success) {
+            qint64 position = writer->changePosition();
+            writer->loadIsbnFilter();
+            startChangeMonitor(position);
+            
+            // The journal only has to cover clients that are running; trim
+            // it now and then so it does not grow with every edit ever made
+            writer->pruneChanges(ChangeRetentionHours);
+            QTimer *pruneTimer = new QTimer(m_writeContext);
+            connect(pruneTimer, &QTimer::timeout, m_writeContext, []() {
+                DatabasePool::instance().writer()->pruneChanges(ChangeRetentionHours);
+            });
+            pruneTimer->start(ChangePruneInterval);
+        }
+        emit ready(success);
+    });
+}
+
+DatabaseService::~DatabaseService()
+{
+    cancelSearch();
+    
+    // quit() would drop posted work that has not started, so the writer is
+    // told to quit from behind its queue: mutations already asked for still
+    // run. Pending reads are of no use any more and are dropped.
+    post(m_writeContext, [this]() {
+        m_writeThread.quit();
+    });
+    m_readThread.quit();
+    m_readThread.wait();
+    m_writeThread.wait();
+}
+
+QObject *DatabaseService::startThread(QThread &thread, const QString &name)
+{
+    QObject *context = new QObject;
+    thread.setObjectName(name);
+    context->moveToThread(&thread);
+    connect(&thread, &QThread::finished, context, &QObject::deleteLater);
+    thread.start();
+    return context;
+}
+
+template <typename Function>
+void DatabaseService::post(QObject *context, Function function)
+{
+    QMetaObject::invokeMethod(context, function, Qt::QueuedConnection);
+}
+
+void DatabaseService::startChangeMonitor(qint64 position)
+{
+    post(m_readContext, [this, position]() {
+        // The first poll always reads the journal, catching up on commits
+        // made since position was taken
+        m_dataVersion = -1;
+        m_syncPosition = position;
+        
+        // Owned by the context, so it stops when the reader thread does
+        QTimer *timer = new QTimer(m_readContext);
+        connect(timer, &QTimer::timeout, m_readContext, [this]() { pollChanges(); });
+        timer->start(ChangePollInterval);
+    });
+}
+
+void DatabaseService::pollChanges()
+{
+    // data_version is a per-connection counter that SQLite bumps when any
+    // other connection commits; while it is unchanged nothing is read
+    Database *reader = DatabasePool::instance().reader();
+    qint64 version = reader->dataVersion();
+    if (version == m_dataVersion) {
+        return;
+    }
+    m_dataVersion = version;
+    
+    // This process's own writes come back through the journal as well.
+    // Their signals went out already, so they are skipped, a whole import
+    // at a time where possible.
+    DatabasePool &pool = DatabasePool::instance();
+    QVector<BookChange> changes;
+    qint64 position = m_syncPosition;
+    bool pruned = false;
+    for (;;) {
+        position = pool.skipOwnChanges(position);
+        QVector<BookChange> batch = reader->changesSince(position, MaxIncrementalChanges + 1);
+        // Sequences have no gaps, except where pruneChanges() removed rows
+        // this client had not read yet
+        if (!batch.isEmpty() && batch.first().sequence > position + 1) {
+            pruned = true;
+            break;
+        }
+        for (const BookChange &change : qAsConst(batch)) {
+            position = change.sequence;
+            if (!pool.isOwnChange(change.sequence)) {
+                changes.append(change);
+            }
+        }
+        if (batch.size() <= MaxIncrementalChanges || changes.size() > MaxIncrementalChanges) {
+            break;
+        }
+    }
+    m_syncPosition = position;
+    pool.forgetOwnChanges(position);
+    
+    if (!pruned && changes.isEmpty()) {
+        return;
+    }
+    
+    if (pruned || changes.size() > MaxIncrementalChanges) {
+        m_syncPosition = reader->changePosition();
+        pool.forgetOwnChanges(m_syncPosition);
+        post(m_writeContext, []() {
+            DatabasePool::instance().writer()->loadIsbnFilter();
+        });
+        emit catalogChanged();
+        return;
+    }
+    
+    // Several changes to one book collapse to its current row. A book whose
+    // first change here is an insert was not in the catalog before.
+    QVector<Book> changed;
+    QStringList added;
+    QStringList removed;
+    QSet<QString> seen;
+    QSet<QString> inserted;
+    QSet<QString> created;
+    for (const BookChange &change : qAsConst(changes)) {
+        if (change.operation == 'I') {
+            inserted.insert(change.isbn);
+        }
+        if (!seen.contains(change.isbn)) {
+            seen.insert(change.isbn);
+            if (change.operation == 'I') {
+                created.insert(change.isbn);
+            }
+        }
+    }
+    seen.clear();
+    for (auto it = changes.crbegin(); it != changes.crend(); ++it) {
+        if (seen.contains(it->isbn)) {
+            continue;
+        }
+        seen.insert(it->isbn);
+        
+        Book book = reader->getBookByISBN(it->isbn);
+        if (book.ISBN.isEmpty()) {
+            // Added and removed again: never part of anyone's view
+            if (!created.contains(it->isbn)) {
+                removed.append(it->isbn);
+            }
+        } else {
+            changed.append(book);
+            if (created.contains(book.ISBN)) {
+                added.append(book.ISBN);
+            }
+        }
+    }
+    
+    // Every insert is counted, even for books that are gone again: this
+    // client may have deleted one before seeing it arrive, and its
+    // removeBook() decrement has to be matched. Other clients' deletes are
+    // left counted, which only costs a confirming query.
+    for (const QString &isbn : qAsConst(inserted)) {
+        pool.isbnFilter()->insert(isbn);
+    }
+    
+    emit booksChanged(changed, added, removed);
+}
+
+int DatabaseService::startSearch()
+{
+    int requestId = m_nextRequestId.fetchAndAddOrdered(1) + 1;
+    m_currentSearchId.storeRelease(requestId);
+    return requestId;
+}
+
+bool DatabaseService::isCurrentSearch(int requestId) const
+{
+    return m_currentSearchId.loadAcquire() == requestId;
+}
+
+int DatabaseService::searchBooks(const QString &query)
+{
+    int requestId = startSearch();
+    post(m_readContext, [this, requestId, query]() {
+        // Skip searches that were superseded while queued, and drop
+        // results that were superseded while running
+        if (!isCurrentSearch(requestId)) {
+            return;
+        }
+        QVector<Book> books = DatabasePool::instance().reader()->searchBooks(query);
+        if (isCurrentSearch(requestId)) {
+            emit booksReady(requestId, books);
+        }
+    });
+    return requestId;
+}
+
+int DatabaseService::loadStatistics()
+{
+    int requestId = m_nextRequestId.fetchAndAddOrdered(1) + 1;
+    post(m_readContext, [this, requestId]() {
+        emit statisticsReady(requestId, DatabasePool::instance().reader()->getStatistics());
+    });
+    return requestId;
+}
+
+int DatabaseService::loadOverdueLoans(int limit)
+{
+    int requestId = m_nextRequestId.fetchAndAddOrdered(1) + 1;
+    post(m_readContext, [this, requestId, limit]() {
+        emit overdueLoansReady(requestId, DatabasePool::instance().reader()->overdueLoans(limit));
+    });
+    return requestId;
+}
+
+void DatabaseService::cancelSearch()
+{
+    m_currentSearchId.storeRelease(0);
+}
+
+int DatabaseService::addBook(const Book &book)
+{
+    int requestId = m_nextRequestId.fetchAndAddOrdered(1) + 1;
+    post(m_writeContext, [this, requestId, book]() {
+        emit mutationFinished(requestId, DatabasePool::instance().writer()->addBook(book));
+    });
+    return requestId;
+}
+
+int DatabaseService::updateBook(const QString &isbn, const Book &book)
+{
+    int requestId = m_nextRequestId.fetchAndAddOrdered(1) + 1;
+    post(m_writeContext, [this, requestId, isbn, book]() {
+        emit mutationFinished(requestId, DatabasePool::instance().writer()->updateBook(isbn, book));
+    });
+    return requestId;
+}
+
+int DatabaseService::removeBook(const QString &isbn)
+{
+    int requestId = m_nextRequestId.fetchAndAddOrdered(1) + 1;
+    post(m_writeContext, [this, requestId, isbn]() {
+        emit mutationFinished(requestId, DatabasePool::instance().writer()->removeBook(isbn));
+    });
+    return requestId;
+}
+
+int DatabaseService::checkoutBook(const QString &isbn, const QString &borrower, int loanDays)
+{
+    int requestId = m_nextRequestId.fetchAndAddOrdered(1) + 1;
+    post(m_writeContext, [this, requestId, isbn, borrower, loanDays]() {
+        emit mutationFinished(requestId, DatabasePool::instance().writer()->checkoutBook(isbn, borrower, loanDays));
+    });
+    return requestId;
+}
+
+int DatabaseService::returnBook(const QString &isbn)
+{
+    int requestId = m_nextRequestId.fetchAndAddOrdered(1) + 1;
+    post(m_writeContext, [this, requestId, isbn]() {
+        Loan loan;
+        bool success = DatabasePool::instance().writer()->returnBook(isbn, &loan);
+        if (success) {
+            emit loanClosed(requestId, loan);
+        }
+        emit mutationFinished(requestId, success);
+    });
+    return requestId;
+}
@@ -0,0 +1,89 @@
+#ifndef DATABASESERVICE_H
+#define DATABASESERVICE_H
+
+#include <QObject>
+#include <QThread>
+#include <QAtomicInt>
+#include "database.h"
+
+// Runs database work off the caller's thread: queries on a reader thread
+// with a read-only pooled connection, mutations on a writer thread with
+// the pool's writer connection, so a slow write never delays a search.
+// Every call returns immediately with a request id; the result arrives
+// later through the matching signal, delivered on the caller's thread.
+// The database is opened (and its schema checked) on the writer thread;
+// wait for ready() before reading from the pool on other threads.
+class DatabaseService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DatabaseService(const QString &databasePath, QObject *parent = nullptr);
+    ~DatabaseService();
+    
+    // Queries. A new search supersedes any earlier one that has not
+    // delivered yet; superseded results are never emitted.
+    int searchBooks(const QString &query);
+    int loadStatistics();
+    int loadOverdueLoans(int limit = 100);
+    void cancelSearch();
+    
+    // Mutations
+    int addBook(const Book &book);
+    int updateBook(const QString &isbn, const Book &book);
+    int removeBook(const QString &isbn);
+    int checkoutBook(const QString &isbn, const QString &borrower, int loanDays = Database::DefaultLoanDays);
+    int returnBook(const QString &isbn);
+
+signals:
+    // The schema is in place and readers may connect
+    void ready(bool success);
+    void booksReady(int requestId, const QVector<Book> &books);
+    void statisticsReady(int requestId, const LibraryStatistics &statistics);
+    void overdueLoansReady(int requestId, const QVector<Loan> &loans);
+    void mutationFinished(int requestId, bool success);
+    // Sent just before mutationFinished() for a successful returnBook(),
+    // with the loan that same write closed
+    void loanClosed(int requestId, const Loan &loan);
+    
+    // Change notifications forwarded from the worker connection
+    void bookAdded(const Book &book);
+    void bookUpdated(const Book &before, const Book &after);
+    void bookRemoved(const Book &book);
+    
+    // Changes committed by other processes sharing the file, read from the
+    // change journal. Writes made in this process are left out; the
+    // signals above already reported them. `added` names the books in
+    // `changed` that did not exist before these changes.
+    void booksChanged(const QVector<Book> &changed, const QStringList &added, const QStringList &removed);
+    // Too many changes to apply one by one; reload instead
+    void catalogChanged();
+
+private:
+    template <typename Function>
+    static void post(QObject *context, Function function);
+    static QObject *startThread(QThread &thread, const QString &name);
+    int startSearch();
+    bool isCurrentSearch(int requestId) const;
+    void startChangeMonitor(qint64 position);
+    void pollChanges();
+    
+    // Each context lives on its thread and is the target of posted work;
+    // connections come from DatabasePool and close when the thread exits
+    QThread m_readThread;
+    QThread m_writeThread;
+    QObject *m_readContext;
+    QObject *m_writeContext;
+    QAtomicInt m_nextRequestId;
+    QAtomicInt m_currentSearchId;
+    
+    // Change monitor state, used on m_readThread only
+    static const int ChangePollInterval = 1000;
+    static const int MaxIncrementalChanges = 500;
+    static const int ChangeRetentionHours = 24;
+    static const int ChangePruneInterval = 60 * 60 * 1000;
+    qint64 m_dataVersion;
+    qint64 m_syncPosition;
+};
+
+#endif // DATABASESERVICE_H
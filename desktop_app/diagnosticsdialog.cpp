@@ -0,0 +1,177 @@
+#include "diagnosticsdialog.h"
+#include "querystatistics.h"
+#include "databasepool.h"
+#include <QFileDialog>
+#include <QFile>
+#include <QFormLayout>
+#include <QHeaderView>
+#include <QJsonDocument>
+#include <QMessageBox>
+
+DiagnosticsDialog::DiagnosticsDialog(QWidget *parent)
+    : QDialog(parent)
+{
+    setupUI();
+    setWindowTitle("Query Diagnostics");
+    resize(900, 600);
+    refresh();
+}
+
+void DiagnosticsDialog::setupUI()
+{
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+    
+    // Slow query threshold
+    QFormLayout *formLayout = new QFormLayout();
+    m_thresholdSpinBox = new QSpinBox();
+    m_thresholdSpinBox->setRange(1, 60000);
+    m_thresholdSpinBox->setSuffix(" ms");
+    m_thresholdSpinBox->setValue(QueryStatistics::instance().slowThreshold());
+    formLayout->addRow("Slow query threshold:", m_thresholdSpinBox);
+    mainLayout->addLayout(formLayout);
+    
+    // Per-statement timings
+    QStringList statementHeaders = {"Statement", "Count", "Avg (ms)", "Max (ms)", "Rows"};
+    statementHeaders += QueryStatistics::bucketLabels();
+    m_statementTable = new QTableWidget(0, statementHeaders.size());
+    m_statementTable->setHorizontalHeaderLabels(statementHeaders);
+    m_statementTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_statementTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_statementTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    mainLayout->addWidget(new QLabel("Statements (by total time):"));
+    mainLayout->addWidget(m_statementTable, 2);
+    
+    // Slow query log and the plan of the selected entry
+    m_slowTable = new QTableWidget(0, 4);
+    m_slowTable->setHorizontalHeaderLabels({"Time", "Elapsed (ms)", "Rows", "Statement"});
+    m_slowTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_slowTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_slowTable->setSelectionMode(QAbstractItemView::SingleSelection);
+    m_slowTable->horizontalHeader()->setSectionResizeMode(3, QHeaderView::Stretch);
+    mainLayout->addWidget(new QLabel("Slow queries:"));
+    mainLayout->addWidget(m_slowTable, 1);
+    
+    m_planView = new QPlainTextEdit();
+    m_planView->setReadOnly(true);
+    m_planView->setPlaceholderText("Select a slow query to see its query plan");
+    m_planView->setMaximumHeight(120);
+    mainLayout->addWidget(m_planView);
+    
+    m_filterLabel = new QLabel();
+    m_filterLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    mainLayout->addWidget(m_filterLabel);
+    
+    // Button layout
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    
+    m_refreshButton = new QPushButton("Refresh");
+    m_resetButton = new QPushButton("Reset");
+    m_exportButton = new QPushButton("Export JSON...");
+    m_closeButton = new QPushButton("Close");
+    m_closeButton->setStyleSheet("QPushButton { background-color: #6c757d; color: white; padding: 8px 16px; border-radius: 4px; }");
+    
+    buttonLayout->addWidget(m_refreshButton);
+    buttonLayout->addWidget(m_resetButton);
+    buttonLayout->addWidget(m_exportButton);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(m_closeButton);
+    
+    mainLayout->addLayout(buttonLayout);
+    
+    // Connect signals
+    connect(m_refreshButton, &QPushButton::clicked, this, &DiagnosticsDialog::refresh);
+    connect(m_resetButton, &QPushButton::clicked, this, &DiagnosticsDialog::resetStatistics);
+    connect(m_exportButton, &QPushButton::clicked, this, &DiagnosticsDialog::exportJson);
+    connect(m_closeButton, &QPushButton::clicked, this, &QDialog::accept);
+    connect(m_slowTable, &QTableWidget::itemSelectionChanged, this, &DiagnosticsDialog::showPlan);
+    connect(m_thresholdSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), [](int value) {
+        QueryStatistics::instance().setSlowThreshold(value);
+    });
+}
+
+void DiagnosticsDialog::refresh()
+{
+    const QVector<QueryStatistics::Statement> statements = QueryStatistics::instance().statements();
+    m_statementTable->setRowCount(statements.size());
+    for (int row = 0; row < statements.size(); ++row) {
+        const QueryStatistics::Statement &statement = statements[row];
+        double average = statement.count ? statement.totalNs / 1e6 / statement.count : 0.0;
+        
+        QTableWidgetItem *sqlItem = new QTableWidgetItem(statement.sql);
+        sqlItem->setToolTip(statement.sql);
+        m_statementTable->setItem(row, 0, sqlItem);
+        m_statementTable->setItem(row, 1, new QTableWidgetItem(QString::number(statement.count)));
+        m_statementTable->setItem(row, 2, new QTableWidgetItem(QString::number(average, 'f', 3)));
+        m_statementTable->setItem(row, 3, new QTableWidgetItem(QString::number(statement.maxNs / 1e6, 'f', 3)));
+        m_statementTable->setItem(row, 4, new QTableWidgetItem(QString::number(statement.rows)));
+        for (int i = 0; i < QueryStatistics::BucketCount; ++i) {
+            m_statementTable->setItem(row, 5 + i, new QTableWidgetItem(QString::number(statement.buckets[i])));
+        }
+    }
+    
+    // Newest first
+    const QVector<QueryStatistics::SlowQuery> slowQueries = QueryStatistics::instance().slowQueries();
+    m_slowTable->setRowCount(slowQueries.size());
+    for (int i = 0; i < slowQueries.size(); ++i) {
+        const QueryStatistics::SlowQuery &slow = slowQueries[slowQueries.size() - 1 - i];
+        m_slowTable->setItem(i, 0, new QTableWidgetItem(slow.at.toString("hh:mm:ss.zzz")));
+        m_slowTable->setItem(i, 1, new QTableWidgetItem(QString::number(slow.elapsedNs / 1e6, 'f', 3)));
+        m_slowTable->setItem(i, 2, new QTableWidgetItem(QString::number(slow.rows)));
+        m_slowTable->setItem(i, 3, new QTableWidgetItem(slow.sql));
+    }
+    m_planView->clear();
+    
+    IsbnFilter::Statistics filter = DatabasePool::instance().isbnFilter()->statistics();
+    if (!filter.loaded) {
+        m_filterLabel->setText("ISBN filter: not loaded");
+    } else {
+        m_filterLabel->setText(QString("ISBN filter: %1 ISBNs in %2 KiB, expected false positives %3%; "
+                                       "%4 lookups, %5 answered without a query, %6 false positives (%7%)")
+                               .arg(filter.items)
+                               .arg(filter.bytes / 1024)
+                               .arg(filter.expectedFalsePositiveRate * 100, 0, 'f', 2)
+                               .arg(filter.lookups)
+                               .arg(filter.definiteMisses)
+                               .arg(filter.falsePositives)
+                               .arg(filter.observedFalsePositiveRate() * 100, 0, 'f', 2));
+    }
+}
+
+void DiagnosticsDialog::resetStatistics()
+{
+    QueryStatistics::instance().reset();
+    DatabasePool::instance().isbnFilter()->resetStatistics();
+    refresh();
+}
+
+void DiagnosticsDialog::exportJson()
+{
+    QString fileName = QFileDialog::getSaveFileName(this,
+                                                   "Export Diagnostics",
+                                                   "query_diagnostics.json",
+                                                   "JSON Files (*.json)");
+    
+    if (!fileName.isEmpty()) {
+        QFile file(fileName);
+        if (file.open(QIODevice::WriteOnly)) {
+            QJsonObject diagnostics = QueryStatistics::instance().toJson();
+            diagnostics["isbnFilter"] = DatabasePool::instance().isbnFilter()->toJson();
+            file.write(QJsonDocument(diagnostics).toJson());
+        } else {
+            QMessageBox::warning(this, "Export Error", "Failed to export diagnostics.");
+        }
+    }
+}
+
+void DiagnosticsDialog::showPlan()
+{
+    QList<QTableWidgetItem *> selected = m_slowTable->selectedItems();
+    if (selected.isEmpty()) {
+        m_planView->clear();
+        return;
+    }
+    
+    QTableWidgetItem *sqlItem = m_slowTable->item(selected.first()->row(), 3);
+    QString plan = sqlItem ? QueryStatistics::instance().plan(sqlItem->text()) : QString();
+    m_planView->setPlainText(plan.isEmpty() ? "No query plan captured" : plan);
+}
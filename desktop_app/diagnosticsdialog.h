@@ -0,0 +1,43 @@
+#ifndef DIAGNOSTICSDIALOG_H
+#define DIAGNOSTICSDIALOG_H
+
+#include <QDialog>
+#include <QTableWidget>
+#include <QPlainTextEdit>
+#include <QSpinBox>
+#include <QPushButton>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QLabel>
+
+// Shows the query timings collected by QueryStatistics: per-statement
+// latency histograms, the slow-query log and the captured query plans,
+// plus the hit rates of the ISBN duplicate filter
+class DiagnosticsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit DiagnosticsDialog(QWidget *parent = nullptr);
+
+private slots:
+    void refresh();
+    void resetStatistics();
+    void exportJson();
+    void showPlan();
+
+private:
+    void setupUI();
+    
+    QTableWidget *m_statementTable;
+    QTableWidget *m_slowTable;
+    QPlainTextEdit *m_planView;
+    QLabel *m_filterLabel;
+    QSpinBox *m_thresholdSpinBox;
+    QPushButton *m_refreshButton;
+    QPushButton *m_resetButton;
+    QPushButton *m_exportButton;
+    QPushButton *m_closeButton;
+};
+
+#endif // DIAGNOSTICSDIALOG_H
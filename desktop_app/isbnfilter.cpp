@@ -0,0 +1,229 @@
+#include "isbnfilter.h"
+#include <QHash>
+#include <QtMath>
+
+namespace {
+
+const int MaxCount = 15;
+const qint64 MinCapacity = 4096;
+const uint FirstSeed = 0x9e3779b9u;
+const uint SecondSeed = 0x85ebca6bu;
+
+double falsePositiveRate(qint64 items, qint64 slots, int hashes)
+{
+    if (slots <= 0 || items <= 0) {
+        return 0.0;
+    }
+    return qPow(1.0 - qExp(-double(hashes) * items / slots), hashes);
+}
+
+} // namespace
+
+IsbnFilter::Builder::Builder(qint64 expectedItems)
+    : m_items(0)
+{
+    // Twice the current size leaves room for the catalog to grow before
+    // the false-positive rate drifts above the target
+    m_capacity = qMax(MinCapacity, expectedItems * 2);
+    const double ln2 = qLn(2.0);
+    m_slots = qint64(qCeil(-m_capacity * qLn(TargetFalsePositiveRate) / (ln2 * ln2)));
+    m_hashes = qBound(1, qRound(double(m_slots) / m_capacity * ln2), 16);
+    m_counters = QByteArray(int((m_slots + 1) / 2), '\0');
+}
+
+void IsbnFilter::Builder::insert(const QString &isbn)
+{
+    Probe p = probe(isbn);
+    for (int i = 0; i < m_hashes; ++i) {
+        qint64 slot = qint64((p.first + i * p.step) % quint64(m_slots));
+        int count = counter(m_counters, slot);
+        if (count < MaxCount) {
+            setCounter(m_counters, slot, count + 1);
+        }
+    }
+    m_items++;
+}
+
+double IsbnFilter::Statistics::observedFalsePositiveRate() const
+{
+    qint64 absent = definiteMisses + falsePositives;
+    return absent > 0 ? double(falsePositives) / absent : 0.0;
+}
+
+IsbnFilter::IsbnFilter()
+    : m_loaded(false)
+    , m_capacity(0)
+    , m_slots(0)
+    , m_hashes(0)
+    , m_items(0)
+    , m_lookups(0)
+    , m_possibleHits(0)
+    , m_falsePositives(0)
+{
+}
+
+void IsbnFilter::load(Builder &builder)
+{
+    QWriteLocker locker(&m_lock);
+    m_capacity = builder.m_capacity;
+    m_slots = builder.m_slots;
+    m_hashes = builder.m_hashes;
+    m_items = builder.m_items;
+    m_counters.swap(builder.m_counters);
+    m_loaded = true;
+}
+
+void IsbnFilter::clear()
+{
+    QWriteLocker locker(&m_lock);
+    m_loaded = false;
+    m_capacity = m_slots = m_items = 0;
+    m_hashes = 0;
+    m_counters.clear();
+}
+
+bool IsbnFilter::needsRebuild() const
+{
+    QReadLocker locker(&m_lock);
+    return m_loaded && m_items > m_capacity;
+}
+
+bool IsbnFilter::mightContain(const QString &isbn) const
+{
+    m_lookups.fetchAndAddRelaxed(1);
+    
+    QReadLocker locker(&m_lock);
+    bool possible = !m_loaded || containsLocked(probe(isbn));
+    
+    if (possible) {
+        m_possibleHits.fetchAndAddRelaxed(1);
+    }
+    return possible;
+}
+
+void IsbnFilter::recordFalsePositive()
+{
+    m_falsePositives.fetchAndAddRelaxed(1);
+}
+
+void IsbnFilter::insert(const QString &isbn)
+{
+    QWriteLocker locker(&m_lock);
+    if (m_loaded) {
+        insertLocked(probe(isbn));
+    }
+}
+
+void IsbnFilter::remove(const QString &isbn)
+{
+    QWriteLocker locker(&m_lock);
+    if (m_loaded) {
+        removeLocked(probe(isbn));
+    }
+}
+
+IsbnFilter::Statistics IsbnFilter::statistics() const
+{
+    Statistics stats;
+    {
+        QReadLocker locker(&m_lock);
+        stats.loaded = m_loaded;
+        stats.items = m_items;
+        stats.capacity = m_capacity;
+        stats.hashes = m_hashes;
+        stats.bytes = m_counters.size();
+        stats.expectedFalsePositiveRate = falsePositiveRate(m_items, m_slots, m_hashes);
+    }
+    stats.lookups = m_lookups.loadAcquire();
+    stats.possibleHits = m_possibleHits.loadAcquire();
+    stats.definiteMisses = stats.lookups - stats.possibleHits;
+    stats.falsePositives = m_falsePositives.loadAcquire();
+    return stats;
+}
+
+QJsonObject IsbnFilter::toJson() const
+{
+    Statistics stats = statistics();
+    QJsonObject json;
+    json["loaded"] = stats.loaded;
+    json["items"] = stats.items;
+    json["capacity"] = stats.capacity;
+    json["hashes"] = stats.hashes;
+    json["bytes"] = stats.bytes;
+    json["expectedFalsePositiveRate"] = stats.expectedFalsePositiveRate;
+    json["lookups"] = stats.lookups;
+    json["definiteMisses"] = stats.definiteMisses;
+    json["possibleHits"] = stats.possibleHits;
+    json["falsePositives"] = stats.falsePositives;
+    json["observedFalsePositiveRate"] = stats.observedFalsePositiveRate();
+    return json;
+}
+
+void IsbnFilter::resetStatistics()
+{
+    m_lookups.storeRelease(0);
+    m_possibleHits.storeRelease(0);
+    m_falsePositives.storeRelease(0);
+}
+
+IsbnFilter::Probe IsbnFilter::probe(const QString &isbn)
+{
+    // Double hashing: k probes from two independent 32-bit hashes
+    Probe p;
+    p.first = qHash(isbn, FirstSeed);
+    p.step = quint64(qHash(isbn, SecondSeed)) | 1;
+    return p;
+}
+
+bool IsbnFilter::containsLocked(const Probe &p) const
+{
+    for (int i = 0; i < m_hashes; ++i) {
+        if (counter(m_counters, qint64((p.first + i * p.step) % quint64(m_slots))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void IsbnFilter::insertLocked(const Probe &p)
+{
+    for (int i = 0; i < m_hashes; ++i) {
+        qint64 slot = qint64((p.first + i * p.step) % quint64(m_slots));
+        int count = counter(m_counters, slot);
+        if (count < MaxCount) {
+            setCounter(m_counters, slot, count + 1);
+        }
+    }
+    m_items++;
+}
+
+void IsbnFilter::removeLocked(const Probe &p)
+{
+    for (int i = 0; i < m_hashes; ++i) {
+        qint64 slot = qint64((p.first + i * p.step) % quint64(m_slots));
+        int count = counter(m_counters, slot);
+        // A saturated counter no longer knows how many entries it holds
+        if (count > 0 && count < MaxCount) {
+            setCounter(m_counters, slot, count - 1);
+        }
+    }
+    if (m_items > 0) {
+        m_items--;
+    }
+}
+
+int IsbnFilter::counter(const QByteArray &counters, qint64 slot)
+{
+    uchar byte = uchar(counters.at(int(slot / 2)));
+    return (slot & 1) ? (byte >> 4) : (byte & 0x0f);
+}
+
+void IsbnFilter::setCounter(QByteArray &counters, qint64 slot, int value)
+{
+    char &byte = counters[int(slot / 2)];
+    if (slot & 1) {
+        byte = char((uchar(byte) & 0x0f) | (value << 4));
+    } else {
+        byte = char((uchar(byte) & 0xf0) | value);
+    }
+}
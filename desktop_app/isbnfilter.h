@@ -0,0 +1,98 @@
+#ifndef ISBNFILTER_H
+#define ISBNFILTER_H
+
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QJsonObject>
+#include <QReadWriteLock>
+#include <QString>
+
+// Counting Bloom filter over the ISBNs in the catalog, so that checking a
+// new ISBN for duplicates usually needs no database lookup: a negative
+// answer is definite, a positive one is confirmed with a query. Entries
+// are removed again only for books this client deleted, so every removal
+// matches an earlier count. Counters that reach MaxCount stay there. Until
+// load() runs every ISBN is a possible hit, so an unloaded filter is
+// always safe to consult.
+class IsbnFilter
+{
+public:
+    static constexpr double TargetFalsePositiveRate = 0.01;
+    
+    // Filled off to the side while lookups keep using the current table
+    class Builder
+    {
+    public:
+        explicit Builder(qint64 expectedItems);
+        void insert(const QString &isbn);
+    
+    private:
+        friend class IsbnFilter;
+        qint64 m_capacity;
+        qint64 m_slots;
+        int m_hashes;
+        qint64 m_items;
+        QByteArray m_counters;
+    };
+    
+    struct Statistics {
+        bool loaded = false;
+        qint64 items = 0;
+        qint64 capacity = 0;
+        int hashes = 0;
+        qint64 bytes = 0;
+        double expectedFalsePositiveRate = 0.0;
+        qint64 lookups = 0;
+        qint64 definiteMisses = 0;
+        qint64 possibleHits = 0;
+        qint64 falsePositives = 0;
+        
+        // Among lookups of ISBNs that turned out not to exist
+        double observedFalsePositiveRate() const;
+    };
+    
+    IsbnFilter();
+    
+    void load(Builder &builder);
+    void clear();
+    // Grown past the capacity it was sized for; load a larger one
+    bool needsRebuild() const;
+    
+    bool mightContain(const QString &isbn) const;
+    // Call when the database did not confirm a possible hit
+    void recordFalsePositive();
+    // For ISBNs known to be in the catalog; counting one twice is harmless
+    void insert(const QString &isbn);
+    // Only for ISBNs that were inserted and have just been deleted
+    void remove(const QString &isbn);
+    
+    Statistics statistics() const;
+    QJsonObject toJson() const;
+    void resetStatistics();
+
+private:
+    struct Probe {
+        quint64 first;
+        quint64 step;
+    };
+    static Probe probe(const QString &isbn);
+    bool containsLocked(const Probe &p) const;
+    void insertLocked(const Probe &p);
+    void removeLocked(const Probe &p);
+    static int counter(const QByteArray &counters, qint64 slot);
+    static void setCounter(QByteArray &counters, qint64 slot, int value);
+    
+    mutable QReadWriteLock m_lock;
+    bool m_loaded;
+    qint64 m_capacity;
+    qint64 m_slots;
+    int m_hashes;
+    qint64 m_items;
+    QByteArray m_counters;
+    
+    mutable QAtomicInteger<qint64> m_lookups;
+    mutable QAtomicInteger<qint64> m_possibleHits;
+    QAtomicInteger<qint64> m_falsePositives;
+};
+
+#endif // ISBNFILTER_H
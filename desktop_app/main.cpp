@@ -4,11 +4,14 @@
 #include <QDir>
 #include <QStandardPaths>
 #include <QDesktopWidget>
+#include <QTimer>
 #include "mainwindow.h"
-#include "database.h"
+#include "auditlog.h"
+#include "startuptrace.h"
 
 int main(int argc, char *argv[])
 {
+    StartupTrace::mark("main");
     QApplication app(argc, argv);
     
     // Set application properties
@@ -37,12 +40,21 @@ int main(int argc, char *argv[])
     
     app.setPalette(darkPalette);
     
-    // Initialize database
-    Database::instance().initialize();
+    StartupTrace::mark("application configured");
     
-    // Create and show main window
+    // Show the window first; it opens the database in the background
     MainWindow window;
+    StartupTrace::mark("window constructed");
     window.show();
+    StartupTrace::mark("window shown");
     
-    return app.exec();
+    // Start the circulation audit trail writer once the event loop runs
+    QTimer::singleShot(0, [&]() {
+        AuditLog::instance().start(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/audit");
+        StartupTrace::mark("audit log started");
+    });
+    
+    int result = app.exec();
+    AuditLog::instance().stop();
+    return result;
 }
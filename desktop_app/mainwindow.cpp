@@ -1,23 +1,35 @@
 #include "mainwindow.h"
 #include "bookdialog.h"
 #include "database.h"
+#include "auditlog.h"
+#include "diagnosticsdialog.h"
+#include "startuptrace.h"
 #include <QMessageBox>
 #include <QInputDialog>
 #include <QFileDialog>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonArray>
 #include <QHeaderView>
 #include <QApplication>
 #include <QDesktopWidget>
 #include <QDesktopServices>
 #include <QUrl>
+#include <QDir>
+#include <QFileInfo>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , m_bookModel(new BookModel(this))
+    , m_databaseService(new DatabaseService(Database::defaultPath(), this))
+    , m_databaseReady(false)
+    , m_pendingBooksRequest(0)
+    , m_searchTimer(new QTimer(this))
+    , m_pendingOverdueRequest(0)
+    , m_exporter(new CatalogExporter(this))
+    , m_importer(new CatalogImporter(this))
     , m_updateDialog(nullptr)
     , m_updateTimer(new QTimer(this))
+    , m_backupManager(new BackupManager(Database::defaultPath(), this))
+    , m_backupAction(nullptr)
+    , m_manualBackup(false)
 {
     setupUI();
     setupMenuBar();
@@ -39,15 +51,10 @@ MainWindow::MainWindow(QWidget *parent)
         height()
     );
     
-    // Auto-check for updates every 24 hours
-    m_updateTimer->setInterval(24 * 60 * 60 * 1000); // 24 hours
-    connect(m_updateTimer, &QTimer::timeout, this, &MainWindow::checkForUpdates);
-    m_updateTimer->start();
-    
-    // Initial update check
-    QTimer::singleShot(5000, this, &MainWindow::checkForUpdates);
-    
-    updateStatistics();
+    // The database opens on the service's writer thread; the catalog is
+    // loaded from onDatabaseReady() so the window can paint first
+    setDatabaseActionsEnabled(false);
+    m_statusLabel->setText("Opening library...");
 }
 
 MainWindow::~MainWindow()
@@ -78,6 +85,7 @@ void MainWindow::setupUI()
     m_bookTable->setSelectionBehavior(QAbstractItemView::SelectRows);
     m_bookTable->setAlternatingRowColors(true);
     m_bookTable->setSortingEnabled(true);
+    m_bookTable->sortByColumn(0, Qt::AscendingOrder);
     m_bookTable->horizontalHeader()->setStretchLastSection(true);
     m_bookTable->setStyleSheet(
         "QTableView { gridline-color: #404040; }"
@@ -153,9 +161,26 @@ void MainWindow::setupMenuBar()
     QMenu *toolsMenu = menuBar->addMenu("&Tools");
     QAction *checkUpdatesAction = toolsMenu->addAction("Check for &Updates");
     QAction *refreshAction = toolsMenu->addAction("&Refresh Library");
+    QAction *overdueAction = toolsMenu->addAction("&Overdue Loans");
+    QAction *diagnosticsAction = toolsMenu->addAction("Query &Diagnostics");
+    toolsMenu->addSeparator();
+    m_backupAction = toolsMenu->addAction("Back Up &Now");
+    QAction *backupFolderAction = toolsMenu->addAction("Open Backup &Folder");
     
     connect(checkUpdatesAction, &QAction::triggered, this, &MainWindow::checkForUpdates);
     connect(refreshAction, &QAction::triggered, this, &MainWindow::refreshLibrary);
+    connect(overdueAction, &QAction::triggered, this, &MainWindow::showOverdueLoans);
+    connect(diagnosticsAction, &QAction::triggered, this, &MainWindow::showDiagnostics);
+    connect(m_backupAction, &QAction::triggered, this, &MainWindow::backUpNow);
+    connect(backupFolderAction, &QAction::triggered, this, &MainWindow::openBackupFolder);
+    
+    m_databaseActions << importAction << exportAction << refreshAction << overdueAction
+                      << diagnosticsAction;
+    if (!m_backupManager->isAvailable()) {
+        m_backupAction->setToolTip(m_backupManager->unavailableReason());
+        m_backupAction->setStatusTip(m_backupManager->unavailableReason());
+        toolsMenu->setToolTipsVisible(true);
+    }
     
     // Help menu
     QMenu *helpMenu = menuBar->addMenu("&Help");
@@ -167,8 +192,8 @@ void MainWindow::setupMenuBar()
 void MainWindow::setupToolBar()
 {
     QToolBar *toolBar = addToolBar("Main Toolbar");
-    toolBar->addAction("Add Book", this, &MainWindow::addBook);
-    toolBar->addAction("Search", this, &MainWindow::searchBooks);
+    m_databaseActions << toolBar->addAction("Add Book", this, &MainWindow::addBook);
+    m_databaseActions << toolBar->addAction("Search", this, &MainWindow::searchBooks);
     toolBar->addSeparator();
     toolBar->addAction("Check Updates", this, &MainWindow::checkForUpdates);
 }
@@ -177,10 +202,13 @@ void MainWindow::setupStatusBar()
 {
     m_progressBar = new QProgressBar();
     m_progressBar->setVisible(false);
+    m_cancelButton = new QPushButton("Cancel");
+    m_cancelButton->setVisible(false);
     m_statusLabel = new QLabel("Ready");
     
     statusBar()->addWidget(m_statusLabel, 1);
     statusBar()->addPermanentWidget(m_progressBar);
+    statusBar()->addPermanentWidget(m_cancelButton);
 }
 
 void MainWindow::connectSignals()
@@ -194,6 +222,43 @@ void MainWindow::connectSignals()
     connect(m_statsButton, &QPushButton::clicked, this, &MainWindow::showStatistics);
     connect(m_searchButton, &QPushButton::clicked, this, &MainWindow::searchBooks);
     connect(m_searchEdit, &QLineEdit::returnPressed, this, &MainWindow::searchBooks);
+    
+    // Search as you type, once typing pauses
+    m_searchTimer->setSingleShot(true);
+    m_searchTimer->setInterval(250);
+    connect(m_searchEdit, &QLineEdit::textChanged, m_searchTimer, QOverload<>::of(&QTimer::start));
+    connect(m_searchTimer, &QTimer::timeout, this, &MainWindow::searchBooks);
+    
+    // Results of background database work
+    connect(m_databaseService, &DatabaseService::ready, this, &MainWindow::onDatabaseReady);
+    connect(m_databaseService, &DatabaseService::booksReady, this, &MainWindow::onBooksReady);
+    connect(m_databaseService, &DatabaseService::statisticsReady, this, &MainWindow::onStatisticsReady);
+    connect(m_databaseService, &DatabaseService::overdueLoansReady, this, &MainWindow::onOverdueLoansReady);
+    connect(m_databaseService, &DatabaseService::loanClosed, this, &MainWindow::onLoanClosed);
+    connect(m_databaseService, &DatabaseService::mutationFinished, this, &MainWindow::onMutationFinished);
+    
+    // Single-book changes update only the affected row and the counters
+    connect(m_databaseService, &DatabaseService::bookAdded, m_bookModel, &BookModel::insertBook);
+    connect(m_databaseService, &DatabaseService::bookUpdated, m_bookModel, &BookModel::updateBook);
+    connect(m_databaseService, &DatabaseService::bookRemoved, m_bookModel, &BookModel::removeBook);
+    connect(m_databaseService, &DatabaseService::bookAdded, this, &MainWindow::onBookAdded);
+    connect(m_databaseService, &DatabaseService::bookUpdated, this, &MainWindow::onBookUpdated);
+    connect(m_databaseService, &DatabaseService::bookRemoved, this, &MainWindow::onBookRemoved);
+    
+    // Changes from other clients sharing the database file
+    connect(m_databaseService, &DatabaseService::booksChanged, this, &MainWindow::onBooksChanged);
+    connect(m_databaseService, &DatabaseService::catalogChanged, this, &MainWindow::reloadBooks);
+    
+    // Background export and import
+    connect(m_exporter, &CatalogExporter::progress, this, &MainWindow::onExportProgress);
+    connect(m_exporter, &CatalogExporter::finished, this, &MainWindow::onExportFinished);
+    connect(m_exporter, &CatalogExporter::cancelled, this, &MainWindow::onExportCancelled);
+    connect(m_backupManager, &BackupManager::finished, this, &MainWindow::onBackupFinished);
+    connect(m_importer, &CatalogImporter::progress, this, &MainWindow::onImportProgress);
+    connect(m_importer, &CatalogImporter::finished, this, &MainWindow::onImportFinished);
+    connect(m_importer, &CatalogImporter::cancelled, this, &MainWindow::onImportCancelled);
+    connect(m_cancelButton, &QPushButton::clicked, m_exporter, &CatalogExporter::cancel);
+    connect(m_cancelButton, &QPushButton::clicked, m_importer, &CatalogImporter::cancel);
 }
 
 void MainWindow::addBook()
@@ -201,13 +266,13 @@ void MainWindow::addBook()
     BookDialog dialog(this);
     if (dialog.exec() == QDialog::Accepted) {
         Book book = dialog.getBook();
-        if (Database::instance().addBook(book)) {
-            m_bookModel->refreshData();
-            updateStatistics();
-            m_statusLabel->setText("Book added successfully");
-        } else {
-            QMessageBox::warning(this, "Error", "Failed to add book. ISBN might already exist.");
-        }
+        runMutation(m_databaseService->addBook(book), [this](bool success) {
+            if (success) {
+                m_statusLabel->setText("Book added successfully");
+            } else {
+                QMessageBox::warning(this, "Error", "Failed to add book. ISBN might already exist.");
+            }
+        });
     }
 }
 
@@ -225,13 +290,13 @@ void MainWindow::editBook()
     BookDialog dialog(this, book);
     if (dialog.exec() == QDialog::Accepted) {
         Book updatedBook = dialog.getBook();
-        if (Database::instance().updateBook(book.ISBN, updatedBook)) {
-            m_bookModel->refreshData();
-            updateStatistics();
-            m_statusLabel->setText("Book updated successfully");
-        } else {
-            QMessageBox::warning(this, "Error", "Failed to update book.");
-        }
+        runMutation(m_databaseService->updateBook(book.ISBN, updatedBook), [this](bool success) {
+            if (success) {
+                m_statusLabel->setText("Book updated successfully");
+            } else {
+                QMessageBox::warning(this, "Error", "Failed to update book.");
+            }
+        });
     }
 }
 
@@ -252,25 +317,135 @@ void MainWindow::deleteBook()
                                    QMessageBox::Yes | QMessageBox::No);
     
     if (ret == QMessageBox::Yes) {
-        if (Database::instance().removeBook(book.ISBN)) {
-            m_bookModel->refreshData();
-            updateStatistics();
-            m_statusLabel->setText("Book deleted successfully");
-        } else {
-            QMessageBox::warning(this, "Error", "Failed to delete book.");
-        }
+        runMutation(m_databaseService->removeBook(book.ISBN), [this](bool success) {
+            if (success) {
+                m_statusLabel->setText("Book deleted successfully");
+            } else {
+                QMessageBox::warning(this, "Error", "Failed to delete book.");
+            }
+        });
     }
 }
 
 void MainWindow::searchBooks()
 {
+    m_searchTimer->stop();
+    if (!m_databaseReady) {
+        return; // onDatabaseReady() runs the first search
+    }
+    
     QString query = m_searchEdit->text().trimmed();
-    if (query.isEmpty()) {
-        m_bookModel->refreshData();
-    } else {
-        m_bookModel->searchBooks(query);
+    if (!query.isEmpty() && query == m_pendingQuery && m_pendingBooksRequest != 0) {
+        return; // Already running
+    }
+    
+    m_pendingQuery = query;
+    if (!m_pendingQuery.isEmpty() && m_bookModel->refineSearch(m_pendingQuery)) {
+        m_databaseService->cancelSearch();
+        m_pendingBooksRequest = 0;
+        m_statusLabel->setText(QString("%1 books match \"%2\"").arg(m_bookModel->rowCount()).arg(m_pendingQuery));
+        return;
     }
+    
+    if (m_pendingQuery.isEmpty()) {
+        // Browse the whole catalog page by page
+        m_databaseService->cancelSearch();
+        m_pendingBooksRequest = 0;
+        m_bookModel->showCatalog();
+        m_statusLabel->setText("Showing all books");
+        return;
+    }
+    
+    m_pendingBooksRequest = m_databaseService->searchBooks(m_pendingQuery);
+    m_statusLabel->setText("Searching...");
+}
+
+void MainWindow::reloadBooks()
+{
+    // Re-run the current search (or full listing) and refresh the counters
+    searchBooks();
+    updateStatistics();
+}
+
+void MainWindow::setDatabaseActionsEnabled(bool enabled)
+{
+    // Exit, About and update checks stay available, also when opening fails
+    centralWidget()->setEnabled(enabled);
+    for (QAction *action : qAsConst(m_databaseActions)) {
+        action->setEnabled(enabled);
+    }
+    // Stays off where Qt's SQLite cannot take backups
+    m_backupAction->setEnabled(enabled && m_backupManager->isAvailable());
+}
+
+void MainWindow::onDatabaseReady(bool success)
+{
+    StartupTrace::mark("database ready");
+    if (!success) {
+        m_statusLabel->setText("Failed to open the library database");
+        QMessageBox::critical(this, "Database Error",
+                              QString("Could not open or create the library database at\n%1")
+                              .arg(Database::defaultPath()));
+        return;
+    }
+    
+    m_databaseReady = true;
+    setDatabaseActionsEnabled(true);
+    
+    // Only the first page is read here; the rest streams in as the view scrolls
+    searchBooks();
+    StartupTrace::mark("first page loaded");
     updateStatistics();
+    
+    // Network setup waits until the catalog is on screen
+    QTimer::singleShot(0, this, &MainWindow::startUpdateChecks);
+    m_backupManager->startSchedule();
+}
+
+void MainWindow::startUpdateChecks()
+{
+    // Auto-check for updates every 24 hours
+    m_updateTimer->setInterval(24 * 60 * 60 * 1000); // 24 hours
+    connect(m_updateTimer, &QTimer::timeout, this, &MainWindow::checkForUpdates);
+    m_updateTimer->start();
+    
+    // Initial update check
+    QTimer::singleShot(5000, this, &MainWindow::checkForUpdates);
+    StartupTrace::mark("update checks scheduled");
+}
+
+void MainWindow::runMutation(int requestId, std::function<void(bool)> onFinished)
+{
+    m_pendingMutations.insert(requestId, onFinished);
+}
+
+void MainWindow::onBooksReady(int requestId, const QVector<Book> &books)
+{
+    if (requestId != m_pendingBooksRequest) {
+        return; // Superseded by a newer search
+    }
+    
+    m_pendingBooksRequest = 0;
+    m_bookModel->setBooks(books, m_pendingQuery);
+    if (books.size() >= Database::MaxSearchResults) {
+        m_statusLabel->setText(QString("Showing the first %1 books matching \"%2\"; refine the search to see more")
+                               .arg(books.size()).arg(m_pendingQuery));
+    } else {
+        m_statusLabel->setText(QString("%1 books match \"%2\"").arg(books.size()).arg(m_pendingQuery));
+    }
+}
+
+void MainWindow::onMutationFinished(int requestId, bool success)
+{
+    std::function<void(bool)> onFinished = m_pendingMutations.take(requestId);
+    if (onFinished) {
+        onFinished(success);
+    }
+}
+
+void MainWindow::onLoanClosed(int requestId, const Loan &loan)
+{
+    m_closedLoans.insert(requestId, loan);
 }
 
 void MainWindow::checkoutBook()
@@ -294,13 +469,15 @@ void MainWindow::checkoutBook()
                                            "Enter borrower name:",
                                            QLineEdit::Normal, "", &ok);
     
-    if (ok && !borrower.isEmpty()) {
-        book.checkedOut = true;
-        if (Database::instance().updateBook(book.ISBN, book)) {
-            m_bookModel->refreshData();
-            updateStatistics();
-            m_statusLabel->setText(QString("Book checked out to %1").arg(borrower));
-        }
+    if (ok && !borrower.trimmed().isEmpty()) {
+        QString name = borrower.trimmed();
+        runMutation(m_databaseService->checkoutBook(book.ISBN, name), [this, book, name](bool success) {
+            if (success) {
+                AuditLog::instance().record("checkout", book.ISBN, name);
+                m_statusLabel->setText(QString("Book checked out to %1, due in %2 days")
+                                       .arg(name).arg(Database::DefaultLoanDays));
+            }
+        });
     }
 }
 
@@ -320,38 +497,25 @@ void MainWindow::returnBook()
         return;
     }
     
-    book.checkedOut = false;
-    if (Database::instance().updateBook(book.ISBN, book)) {
-        m_bookModel->refreshData();
-        updateStatistics();
-        m_statusLabel->setText("Book returned successfully");
-    }
+    // Attributed to the borrower of the loan the return actually closed
+    int requestId = m_databaseService->returnBook(book.ISBN);
+    runMutation(requestId, [this, requestId, book](bool success) {
+        Loan loan = m_closedLoans.take(requestId);
+        if (success) {
+            bool overdue = loan.dueAt.isValid() && loan.dueAt < loan.returnedAt;
+            AuditLog::instance().record("return", book.ISBN, loan.borrower);
+            m_statusLabel->setText(overdue ? "Book returned (overdue)" : "Book returned successfully");
+        }
+    });
 }
 
 void MainWindow::refreshLibrary()
 {
-    m_bookModel->refreshData();
-    updateStatistics();
-    m_statusLabel->setText("Library refreshed");
+    reloadBooks();
 }
 
 void MainWindow::showStatistics()
 {
-    QVector<Book> books = Database::instance().getAllBooks();
-    int total = books.size();
-    int available = 0;
-    int checkedOut = 0;
-    
-    for (const Book &book : books) {
-        if (book.checkedOut) {
-            checkedOut++;
-        } else {
-            available++;
-        }
-    }
-    
-    double availabilityRate = total > 0 ? (double)available / total * 100 : 0;
-    
     QString stats = QString(
         "Library Statistics:\n\n"
         "Total Books: %1\n"
@@ -359,8 +523,8 @@ void MainWindow::showStatistics()
         "Checked Out: %3\n"
         "Availability Rate: %4%\n\n"
         "Most Popular Genre: %5"
-    ).arg(total).arg(available).arg(checkedOut)
-     .arg(QString::number(availabilityRate, 'f', 1))
+    ).arg(m_statistics.total).arg(m_statistics.available).arg(m_statistics.checkedOut)
+     .arg(QString::number(m_statistics.availabilityRate(), 'f', 1))
      .arg("Fiction"); // TODO: Calculate actual most popular genre
     
     QMessageBox::information(this, "Library Statistics", stats);
@@ -374,6 +538,74 @@ void MainWindow::checkForUpdates()
     m_updateDialog->checkForUpdates();
 }
 
+void MainWindow::showOverdueLoans()
+{
+    m_statusLabel->setText("Loading overdue loans...");
+    m_pendingOverdueRequest = m_databaseService->loadOverdueLoans(50);
+}
+
+void MainWindow::onOverdueLoansReady(int requestId, const QVector<Loan> &loans)
+{
+    if (requestId != m_pendingOverdueRequest) {
+        return; // Asked for again since
+    }
+    m_pendingOverdueRequest = 0;
+    m_statusLabel->setText(QString("%1 overdue loans").arg(loans.size()));
+    
+    if (loans.isEmpty()) {
+        QMessageBox::information(this, "Overdue Loans", "No books are overdue.");
+        return;
+    }
+    
+    QStringList lines;
+    for (const Loan &loan : loans) {
+        lines << QString("%1 (%2) - %3, due %4")
+                 .arg(loan.title, loan.isbn, loan.borrower,
+                      loan.dueAt.toLocalTime().toString("yyyy-MM-dd"));
+    }
+    QMessageBox::information(this, "Overdue Loans", lines.join('\n'));
+}
+
+void MainWindow::showDiagnostics()
+{
+    DiagnosticsDialog dialog(this);
+    dialog.exec();
+}
+
+void MainWindow::backUpNow()
+{
+    if (m_backupManager->isRunning()) {
+        m_statusLabel->setText("A backup is already running");
+        return;
+    }
+    
+    m_manualBackup = true;
+    m_statusLabel->setText("Backing up library...");
+    m_backupManager->start();
+}
+
+void MainWindow::openBackupFolder()
+{
+    QDir().mkpath(m_backupManager->directory());
+    QDesktopServices::openUrl(QUrl::fromLocalFile(m_backupManager->directory()));
+}
+
+void MainWindow::onBackupFinished(bool success, const QString &path, const QString &error)
+{
+    bool manual = m_manualBackup;
+    m_manualBackup = false;
+    
+    if (success) {
+        m_statusLabel->setText(QString("Library backed up to %1").arg(QFileInfo(path).fileName()));
+    } else {
+        m_statusLabel->setText("Backup failed");
+        // Scheduled backups retry on their own; only report the ones asked for
+        if (manual) {
+            QMessageBox::warning(this, "Backup Error", "Failed to back up the library: " + error);
+        }
+    }
+}
+
 void MainWindow::showAbout()
 {
     QMessageBox::about(this, "About Library Management System",
@@ -385,94 +617,172 @@ void MainWindow::showAbout()
 
 void MainWindow::exportData()
 {
+    if (m_exporter->isRunning() || m_importer->isRunning()) {
+        return;
+    }
+    
     QString fileName = QFileDialog::getSaveFileName(this,
                                                    "Export Books",
                                                    "books_export.json",
-                                                   "JSON Files (*.json)");
+                                                   "JSON Files (*.json);;JSON Lines (*.jsonl);;CSV Files (*.csv)");
     
     if (!fileName.isEmpty()) {
-        QVector<Book> books = Database::instance().getAllBooks();
-        QJsonArray jsonArray;
-        
-        for (const Book &book : books) {
-            QJsonObject jsonBook;
-            jsonBook["title"] = book.title;
-            jsonBook["author"] = book.author;
-            jsonBook["ISBN"] = book.ISBN;
-            jsonBook["genre"] = book.genre;
-            jsonBook["year"] = book.year;
-            jsonBook["checkedOut"] = book.checkedOut;
-            jsonArray.append(jsonBook);
-        }
-        
-        QJsonDocument doc(jsonArray);
-        QFile file(fileName);
-        if (file.open(QIODevice::WriteOnly)) {
-            file.write(doc.toJson());
-            m_statusLabel->setText("Data exported successfully");
-        } else {
-            QMessageBox::warning(this, "Export Error", "Failed to export data.");
-        }
+        showTransferProgress(true);
+        m_statusLabel->setText("Exporting books...");
+        m_exporter->start(fileName, CatalogExporter::formatForFile(fileName));
+    }
+}
+
+void MainWindow::onExportProgress(qint64 written, qint64 total)
+{
+    // Scale to percent; QProgressBar only takes int ranges
+    if (total > 0) {
+        m_progressBar->setRange(0, 100);
+        m_progressBar->setValue(int(qMin<qint64>(100, written * 100 / total)));
+    }
+    m_statusLabel->setText(QString("Exported %1 of %2 books...").arg(written).arg(total));
+}
+
+void MainWindow::onExportFinished(bool success, qint64 written, const QString &error)
+{
+    showTransferProgress(false);
+    
+    if (success) {
+        m_statusLabel->setText(QString("Exported %1 books").arg(written));
+    } else {
+        m_statusLabel->setText("Export failed");
+        QMessageBox::warning(this, "Export Error", "Failed to export data: " + error);
     }
 }
 
+void MainWindow::onExportCancelled(qint64 written)
+{
+    showTransferProgress(false);
+    m_statusLabel->setText(QString("Export cancelled after %1 books").arg(written));
+}
+
 void MainWindow::importData()
 {
+    if (m_exporter->isRunning() || m_importer->isRunning()) {
+        return;
+    }
+    
     QString fileName = QFileDialog::getOpenFileName(this,
                                                    "Import Books",
                                                    "",
-                                                   "JSON Files (*.json)");
+                                                   "JSON Files (*.json *.jsonl);;MARC 21 Records (*.mrc *.marc);;MARCXML Files (*.xml *.marcxml)");
     
     if (!fileName.isEmpty()) {
-        QFile file(fileName);
-        if (file.open(QIODevice::ReadOnly)) {
-            QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
-            QJsonArray jsonArray = doc.array();
-            
-            int imported = 0;
-            for (const QJsonValue &value : jsonArray) {
-                QJsonObject jsonBook = value.toObject();
-                Book book;
-                book.title = jsonBook["title"].toString();
-                book.author = jsonBook["author"].toString();
-                book.ISBN = jsonBook["ISBN"].toString();
-                book.genre = jsonBook["genre"].toString();
-                book.year = jsonBook["year"].toInt();
-                book.checkedOut = jsonBook["checkedOut"].toBool();
-                
-                if (Database::instance().addBook(book)) {
-                    imported++;
-                }
-            }
-            
-            m_bookModel->refreshData();
-            updateStatistics();
-            m_statusLabel->setText(QString("Imported %1 books").arg(imported));
-        } else {
-            QMessageBox::warning(this, "Import Error", "Failed to open file.");
-        }
+        showTransferProgress(true);
+        m_statusLabel->setText("Importing books...");
+        m_importer->start(fileName, CatalogImporter::formatForFile(fileName));
     }
 }
 
-void MainWindow::updateStatistics()
+void MainWindow::onImportProgress(qint64 bytesRead, qint64 bytesTotal, qint64 imported)
+{
+    if (bytesTotal > 0) {
+        m_progressBar->setRange(0, 100);
+        m_progressBar->setValue(int(qMin<qint64>(100, bytesRead * 100 / bytesTotal)));
+    }
+    m_statusLabel->setText(QString("Imported %1 books...").arg(imported));
+}
+
+void MainWindow::onImportFinished(bool success, qint64 inserted, qint64 skipped, qint64 invalid, const QString &error)
 {
-    QVector<Book> books = Database::instance().getAllBooks();
-    int total = books.size();
-    int available = 0;
-    int checkedOut = 0;
+    showTransferProgress(false);
+    if (inserted > 0) {
+        reloadBooks();
+    }
     
-    for (const Book &book : books) {
-        if (book.checkedOut) {
-            checkedOut++;
-        } else {
-            available++;
-        }
+    if (!success) {
+        m_statusLabel->setText(QString("Import stopped after %1 books").arg(inserted));
+        QMessageBox::warning(this, "Import Error", "Failed to import books: " + error);
+        return;
     }
     
-    double availabilityRate = total > 0 ? (double)available / total * 100 : 0;
+    m_statusLabel->setText(QString("Imported %1 books, skipped %2 duplicates and %3 invalid records")
+                           .arg(inserted).arg(skipped).arg(invalid));
+}
+
+void MainWindow::onImportCancelled(qint64 inserted)
+{
+    showTransferProgress(false);
+    if (inserted > 0) {
+        reloadBooks();
+    }
+    m_statusLabel->setText(QString("Import cancelled after %1 books").arg(inserted));
+}
+
+void MainWindow::showTransferProgress(bool visible)
+{
+    // Busy indicator until the first progress report sets a range
+    m_progressBar->setRange(0, 0);
+    m_progressBar->setVisible(visible);
+    m_cancelButton->setVisible(visible);
+}
+
+void MainWindow::updateStatistics()
+{
+    m_databaseService->loadStatistics();
+}
+
+void MainWindow::onStatisticsReady(int requestId, const LibraryStatistics &statistics)
+{
+    Q_UNUSED(requestId)
+    m_statistics = statistics;
+    showStatisticsLabels();
+    StartupTrace::finish("statistics loaded");
+}
+
+void MainWindow::onBookAdded(const Book &book)
+{
+    m_statistics.total++;
+    (book.checkedOut ? m_statistics.checkedOut : m_statistics.available)++;
+    showStatisticsLabels();
+}
+
+void MainWindow::onBookUpdated(const Book &before, const Book &after)
+{
+    if (before.checkedOut != after.checkedOut) {
+        m_statistics.checkedOut += after.checkedOut ? 1 : -1;
+        m_statistics.available += after.checkedOut ? -1 : 1;
+        showStatisticsLabels();
+    }
+}
+
+void MainWindow::onBookRemoved(const Book &book)
+{
+    m_statistics.total--;
+    (book.checkedOut ? m_statistics.checkedOut : m_statistics.available)--;
+    showStatisticsLabels();
+}
+
+void MainWindow::onBooksChanged(const QVector<Book> &changed, const QStringList &added, const QStringList &removed)
+{
+    bool applied = true;
+    for (const Book &book : changed) {
+        applied = applied && m_bookModel->applyChange(book, added.contains(book.ISBN));
+    }
+    for (const QString &isbn : removed) {
+        applied = applied && m_bookModel->applyRemoval(isbn);
+    }
+    if (!applied) {
+        // A change fell on a page that is not held; re-read from the start
+        reloadBooks();
+        return;
+    }
     
-    m_totalBooksLabel->setText(QString("Total Books: %1").arg(total));
-    m_availableBooksLabel->setText(QString("Available: %1").arg(available));
-    m_checkedOutBooksLabel->setText(QString("Checked Out: %1").arg(checkedOut));
-    m_availabilityRateLabel->setText(QString("Availability: %1%").arg(QString::number(availabilityRate, 'f', 1)));
+    // Only other clients' changes arrive here (the service skips our own),
+    // and they carry no before/after pair, so re-count instead of adjusting
+    // the counters
+    updateStatistics();
+}
+
+void MainWindow::showStatisticsLabels()
+{
+    m_totalBooksLabel->setText(QString("Total Books: %1").arg(m_statistics.total));
+    m_availableBooksLabel->setText(QString("Available: %1").arg(m_statistics.available));
+    m_checkedOutBooksLabel->setText(QString("Checked Out: %1").arg(m_statistics.checkedOut));
+    m_availabilityRateLabel->setText(QString("Availability: %1%").arg(QString::number(m_statistics.availabilityRate(), 'f', 1)));
 }
@@ -16,8 +16,14 @@
 #include <QAction>
 #include <QProgressBar>
 #include <QTimer>
+#include <QHash>
+#include <functional>
 #include "bookmodel.h"
+#include "databaseservice.h"
+#include "catalogexporter.h"
+#include "catalogimporter.h"
 #include "updatedialog.h"
+#include "backupmanager.h"
 
 class MainWindow : public QMainWindow
 {
@@ -38,8 +44,29 @@ private slots:
     void showStatistics();
     void checkForUpdates();
     void showAbout();
+    void showDiagnostics();
+    void showOverdueLoans();
+    void backUpNow();
+    void openBackupFolder();
     void exportData();
     void importData();
+    void onDatabaseReady(bool success);
+    void onBooksReady(int requestId, const QVector<Book> &books);
+    void onStatisticsReady(int requestId, const LibraryStatistics &statistics);
+    void onMutationFinished(int requestId, bool success);
+    void onLoanClosed(int requestId, const Loan &loan);
+    void onOverdueLoansReady(int requestId, const QVector<Loan> &loans);
+    void onBookAdded(const Book &book);
+    void onBookUpdated(const Book &before, const Book &after);
+    void onBookRemoved(const Book &book);
+    void onBooksChanged(const QVector<Book> &changed, const QStringList &added, const QStringList &removed);
+    void onExportProgress(qint64 written, qint64 total);
+    void onExportFinished(bool success, qint64 written, const QString &error);
+    void onExportCancelled(qint64 written);
+    void onImportProgress(qint64 bytesRead, qint64 bytesTotal, qint64 imported);
+    void onImportFinished(bool success, qint64 inserted, qint64 skipped, qint64 invalid, const QString &error);
+    void onImportCancelled(qint64 inserted);
+    void onBackupFinished(bool success, const QString &path, const QString &error);
 
 private:
     void setupUI();
@@ -48,6 +75,12 @@ private:
     void setupStatusBar();
     void connectSignals();
     void updateStatistics();
+    void showStatisticsLabels();
+    void reloadBooks();
+    void setDatabaseActionsEnabled(bool enabled);
+    void startUpdateChecks();
+    void runMutation(int requestId, std::function<void(bool)> onFinished);
+    void showTransferProgress(bool visible);
     
     // UI Components
     QTabWidget *m_tabWidget;
@@ -71,12 +104,32 @@ private:
     // Model
     BookModel *m_bookModel;
     
+    // Background database access
+    DatabaseService *m_databaseService;
+    bool m_databaseReady;
+    int m_pendingBooksRequest;
+    QString m_pendingQuery;
+    QTimer *m_searchTimer;
+    QList<QAction *> m_databaseActions; // disabled until the library opens
+    LibraryStatistics m_statistics;
+    QHash<int, std::function<void(bool)>> m_pendingMutations;
+    QHash<int, Loan> m_closedLoans;     // until their returns finish
+    int m_pendingOverdueRequest;
+    CatalogExporter *m_exporter;
+    CatalogImporter *m_importer;
+    
     // Update system
     UpdateDialog *m_updateDialog;
     QTimer *m_updateTimer;
     
+    // Backups
+    BackupManager *m_backupManager;
+    QAction *m_backupAction;
+    bool m_manualBackup;
+    
     // Status bar
     QProgressBar *m_progressBar;
+    QPushButton *m_cancelButton;
     QLabel *m_statusLabel;
 };
 
@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+
+"""Generates a binary delta between two builds for UpdatePatch (updatepatch.cpp).
+
+    python3 make_update_patch.py LibraryManagementSystem-1.0.0.AppImage \\
+        LibraryManagementSystem-1.1.0.AppImage -o LibraryManagementSystem-1.0.0-to-1.1.0.lmsdiff
+
+Attach the patch to the release next to the full package. The updater looks
+for an asset named "LibraryManagementSystem-<installed>-to-<latest>.lmsdiff".
+
+Format (little-endian):
+    header  "LMSDIFF1", u64 base size, 32-byte base SHA-256,
+            u64 target size, 32-byte target SHA-256
+    ops     u8 kind, then
+            1 COPY    u64 offset, u64 length    bytes from the base file
+            2 INSERT  u32 size, payload         qCompress() data: u32 big-endian
+                                                raw length + zlib stream
+            0 END
+"""
+
+import argparse
+import hashlib
+import struct
+import sys
+import zlib
+
+MAGIC = b'LMSDIFF1'
+OP_END, OP_COPY, OP_INSERT = 0, 1, 2
+BLOCK_SIZE = 1024
+MAX_INSERT = 1024 * 1024          # matches UpdatePatch::ChunkSize
+HASH_BASE = 257
+HASH_MASK = 0xFFFFFFFF
+
+
+def block_hash(data, start):
+    h = 0
+    for byte in data[start:start + BLOCK_SIZE]:
+        h = (h * HASH_BASE + byte) & HASH_MASK
+    return h
+
+
+def index_blocks(base):
+    """Maps the rolling hash of every aligned base block to its first offset."""
+    index = {}
+    for offset in range(0, len(base) - BLOCK_SIZE + 1, BLOCK_SIZE):
+        index.setdefault(block_hash(base, offset), offset)
+    return index
+
+
+def match_length(base, base_offset, target, target_offset):
+    """Length of the common run starting at both offsets, compared in slices."""
+    length = 0
+    step = 64 * 1024
+    limit = min(len(base) - base_offset, len(target) - target_offset)
+    while length < limit:
+        n = min(step, limit - length)
+        if base[base_offset + length:base_offset + length + n] == target[target_offset + length:target_offset + length + n]:
+            length += n
+            continue
+        if step == 1:
+            break
+        step = max(1, step // 16)
+    return length
+
+
+def diff(base, target):
+    """Yields (OP_COPY, offset, length) and (OP_INSERT, bytes) covering target."""
+    index = index_blocks(base)
+    top = pow(HASH_BASE, BLOCK_SIZE - 1, HASH_MASK + 1)
+    literal_start = 0
+    pos = 0
+    h = block_hash(target, 0) if len(target) >= BLOCK_SIZE else None
+
+    while h is not None:
+        offset = index.get(h)
+        if offset is not None and base[offset:offset + BLOCK_SIZE] == target[pos:pos + BLOCK_SIZE]:
+            # Grow the match backwards into pending literal bytes, then forwards
+            back = 0
+            while back < pos - literal_start and back < offset and base[offset - back - 1] == target[pos - back - 1]:
+                back += 1
+            length = back + match_length(base, offset, target, pos)
+            if pos - back > literal_start:
+                yield (OP_INSERT, target[literal_start:pos - back])
+            yield (OP_COPY, offset - back, length)
+            pos = pos - back + length
+            literal_start = pos
+            h = block_hash(target, pos) if len(target) - pos >= BLOCK_SIZE else None
+            continue
+
+        # Roll the window one byte forward
+        if pos + BLOCK_SIZE >= len(target):
+            break
+        h = ((h - target[pos] * top) * HASH_BASE + target[pos + BLOCK_SIZE]) & HASH_MASK
+        pos += 1
+
+    if literal_start < len(target):
+        yield (OP_INSERT, target[literal_start:])
+
+
+def write_patch(base, target, out):
+    out.write(MAGIC)
+    out.write(struct.pack('<Q', len(base)) + hashlib.sha256(base).digest())
+    out.write(struct.pack('<Q', len(target)) + hashlib.sha256(target).digest())
+
+    copied = inserted = 0
+    for op in diff(base, target):
+        if op[0] == OP_COPY:
+            out.write(struct.pack('<BQQ', OP_COPY, op[1], op[2]))
+            copied += op[2]
+            continue
+        data = op[1]
+        for start in range(0, len(data), MAX_INSERT):
+            chunk = data[start:start + MAX_INSERT]
+            payload = struct.pack('>I', len(chunk)) + zlib.compress(chunk, 9)
+            out.write(struct.pack('<BI', OP_INSERT, len(payload)) + payload)
+        inserted += len(data)
+    out.write(struct.pack('<B', OP_END))
+    return copied, inserted
+
+
+def apply_patch(base, patch):
+    """Reference implementation of UpdatePatch::apply, used by --verify."""
+    if patch[:8] != MAGIC:
+        raise ValueError('not an update patch')
+    base_size, = struct.unpack_from('<Q', patch, 8)
+    base_digest = patch[16:48]
+    target_size, = struct.unpack_from('<Q', patch, 48)
+    target_digest = patch[56:88]
+    if len(base) != base_size or hashlib.sha256(base).digest() != base_digest:
+        raise ValueError('patch was made for a different base file')
+
+    pos = 88
+    out = bytearray()
+    while True:
+        kind = patch[pos]
+        pos += 1
+        if kind == OP_END:
+            break
+        if kind == OP_COPY:
+            offset, length = struct.unpack_from('<QQ', patch, pos)
+            pos += 16
+            out += base[offset:offset + length]
+        elif kind == OP_INSERT:
+            size, = struct.unpack_from('<I', patch, pos)
+            pos += 4
+            out += zlib.decompress(patch[pos + 4:pos + size])
+            pos += size
+        else:
+            raise ValueError('unknown patch operation %d' % kind)
+
+    if len(out) != target_size or hashlib.sha256(out).digest() != target_digest:
+        raise ValueError('patched file does not match the target')
+    return bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate a binary update patch')
+    parser.add_argument('base', help='installed build the patch applies to')
+    parser.add_argument('target', help='new build')
+    parser.add_argument('-o', '--output', required=True, help='patch file to write')
+    parser.add_argument('--verify', action='store_true', help='apply the patch afterwards and check the result')
+    options = parser.parse_args()
+
+    with open(options.base, 'rb') as f:
+        base = f.read()
+    with open(options.target, 'rb') as f:
+        target = f.read()
+
+    with open(options.output, 'wb') as out:
+        copied, inserted = write_patch(base, target, out)
+        patch_size = out.tell()
+
+    print(f"📦 {options.output}: {patch_size} bytes "
+          f"({100.0 * patch_size / max(1, len(target)):.1f}% of the full {len(target)} bytes)")
+    print(f"   copied {copied} bytes from the base, inserted {inserted} new bytes")
+    print(f"🔑 target SHA-256: {hashlib.sha256(target).hexdigest()}")
+
+    if options.verify:
+        with open(options.output, 'rb') as f:
+            if apply_patch(base, f.read()) != target:
+                print("❌ Verification failed")
+                return 1
+        print("✅ Patch verified")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,244 @@
+#include "marcreader.h"
+#include <QXmlStreamReader>
+
+namespace {
+
+const char SubfieldDelimiter = 0x1F;
+const char FieldTerminator = 0x1E;
+
+// Collects the mapped fields while a record is walked, keeping the first
+// usable value of each; the order of preference between tags is applied
+// at the end, since tags are not guaranteed to arrive in order
+class BookBuilder
+{
+public:
+    void controlField(const QString &tag, const QString &value)
+    {
+        if (tag == "008" && value.size() >= 11) {
+            m_fixedYear = yearIn(value.mid(7, 4));
+        }
+    }
+    
+    void subfield(const QString &tag, QChar ind2, QChar code, const QString &value)
+    {
+        if (code != 'a' && code != 'c') {
+            return;
+        }
+        
+        if (code == 'a') {
+            if (tag == "245") {
+                setOnce(m_title, value);
+            } else if (tag == "100" || tag == "110" || tag == "111") {
+                setOnce(m_mainEntry, value);
+            } else if (tag == "700") {
+                setOnce(m_addedEntry, value);
+            } else if (tag == "650") {
+                setOnce(m_subject, value);
+            } else if (tag == "655") {
+                setOnce(m_genreForm, value);
+            } else if (tag == "020" && m_isbn.isEmpty()) {
+                // "$a 0262033844 (hardcover : alk. paper)"
+                QString isbn = value.section(' ', 0, 0, QString::SectionSkipEmpty);
+                isbn.remove('-');
+                if (Book::isValidISBN(isbn)) {
+                    m_isbn = isbn.toUpper();
+                }
+            }
+        } else if (tag == "264" && ind2 == '1' && m_rdaYear == 0) {
+            m_rdaYear = yearIn(value);
+        } else if (tag == "260" && m_imprintYear == 0) {
+            m_imprintYear = yearIn(value);
+        }
+    }
+    
+    Book book() const
+    {
+        Book book;
+        book.title = trimPunctuation(m_title);
+        book.author = trimPunctuation(!m_mainEntry.isEmpty() ? m_mainEntry : m_addedEntry);
+        book.ISBN = m_isbn;
+        book.genre = trimPunctuation(!m_subject.isEmpty() ? m_subject : m_genreForm);
+        book.year = m_rdaYear ? m_rdaYear : m_imprintYear ? m_imprintYear : m_fixedYear;
+        return book;
+    }
+
+private:
+    static void setOnce(QString &field, const QString &value)
+    {
+        if (field.isEmpty()) {
+            field = value;
+        }
+    }
+    
+    // First run of four digits, e.g. "c1998." or "[2004?]"
+    static int yearIn(const QString &value)
+    {
+        int run = 0;
+        for (int i = 0; i < value.size(); ++i) {
+            if (value[i].isDigit()) {
+                if (++run == 4) {
+                    return value.midRef(i - 3, 4).toInt();
+                }
+            } else {
+                run = 0;
+            }
+        }
+        return 0;
+    }
+    
+    // Strip the ISBD punctuation cataloguers leave at the end of a
+    // subfield ("The Hobbit /", "Tolkien, J. R. R.,")
+    static QString trimPunctuation(const QString &value)
+    {
+        int end = value.size();
+        while (end > 0 && (value[end - 1].isSpace() || QString(" /:;,=").contains(value[end - 1]))) {
+            --end;
+        }
+        // A final period is punctuation unless it ends an initial ("R.")
+        if (end > 2 && value[end - 1] == '.' && !value[end - 3].isSpace() && value[end - 3] != '.') {
+            --end;
+        }
+        return value.left(end).trimmed();
+    }
+    
+    QString m_title;
+    QString m_mainEntry;
+    QString m_addedEntry;
+    QString m_isbn;
+    QString m_subject;
+    QString m_genreForm;
+    int m_rdaYear = 0;
+    int m_imprintYear = 0;
+    int m_fixedYear = 0;
+};
+
+int decimal(const char *digits, int length)
+{
+    int value = 0;
+    for (int i = 0; i < length; ++i) {
+        if (digits[i] < '0' || digits[i] > '9') {
+            return -1;
+        }
+        value = value * 10 + (digits[i] - '0');
+    }
+    return value;
+}
+
+// Only the local part of a possibly prefixed element name ("marc:record")
+QStringRef localName(const QXmlStreamReader &reader)
+{
+    QStringRef name = reader.qualifiedName();
+    int colon = name.indexOf(':');
+    return colon < 0 ? name : name.mid(colon + 1);
+}
+
+} // namespace
+
+bool MarcReader::fromIso2709(const QByteArray &record, Book &book)
+{
+    // Leader: 00-04 record length, 09 character coding, 12-16 base address
+    if (record.size() < 25) {
+        return false;
+    }
+    const char *data = record.constData();
+    const int size = record.size();
+    const int baseAddress = decimal(data + 12, 5);
+    if (baseAddress < 25 || baseAddress > size) {
+        return false;
+    }
+    
+    // MARC-8 records are read as Latin-1; ASCII fields come through
+    // intact, which covers the ISBN, dates and most titles
+    const bool utf8 = data[9] == 'a';
+    auto text = [utf8, data](int start, int length) {
+        return utf8 ? QString::fromUtf8(data + start, length) : QString::fromLatin1(data + start, length);
+    };
+    
+    BookBuilder builder;
+    
+    // Directory: 12-byte entries of tag (3), field length (4), start (5)
+    for (int entry = 24; entry + 12 <= baseAddress && data[entry] != FieldTerminator; entry += 12) {
+        QString tag = QString::fromLatin1(data + entry, 3);
+        int length = decimal(data + entry + 3, 4);
+        int start = decimal(data + entry + 7, 5);
+        if (length <= 0 || start < 0 || baseAddress + start + length > size) {
+            return false;
+        }
+        
+        int fieldStart = baseAddress + start;
+        int fieldEnd = fieldStart + length;
+        if (data[fieldEnd - 1] == FieldTerminator) {
+            --fieldEnd;
+        }
+        
+        if (tag < "010") {
+            builder.controlField(tag, text(fieldStart, fieldEnd - fieldStart));
+            continue;
+        }
+        
+        // Two indicators, then subfields each introduced by the delimiter
+        if (fieldEnd - fieldStart < 2) {
+            continue;
+        }
+        QChar ind2 = QLatin1Char(data[fieldStart + 1]);
+        int position = fieldStart + 2;
+        while (position < fieldEnd) {
+            if (data[position] != SubfieldDelimiter || position + 1 >= fieldEnd) {
+                ++position;
+                continue;
+            }
+            QChar code = QLatin1Char(data[position + 1]);
+            int valueStart = position + 2;
+            int valueEnd = valueStart;
+            while (valueEnd < fieldEnd && data[valueEnd] != SubfieldDelimiter) {
+                ++valueEnd;
+            }
+            builder.subfield(tag, ind2, code, text(valueStart, valueEnd - valueStart));
+            position = valueEnd;
+        }
+    }
+    
+    book = builder.book();
+    return true;
+}
+
+bool MarcReader::fromMarcXml(const QByteArray &record, Book &book)
+{
+    // The record is cut out of a larger document, so its namespace
+    // prefix may be undeclared; match on local names instead
+    QXmlStreamReader reader(record);
+    reader.setNamespaceProcessing(false);
+    
+    BookBuilder builder;
+    QString tag;
+    QChar ind2;
+    
+    while (!reader.atEnd()) {
+        if (reader.readNext() != QXmlStreamReader::StartElement) {
+            continue;
+        }
+        
+        QStringRef name = localName(reader);
+        QXmlStreamAttributes attributes = reader.attributes();
+        if (name == QLatin1String("controlfield")) {
+            QString controlTag = attributes.value("tag").toString();
+            builder.controlField(controlTag, reader.readElementText());
+        } else if (name == QLatin1String("datafield")) {
+            tag = attributes.value("tag").toString();
+            QStringRef indicator = attributes.value("ind2");
+            ind2 = indicator.isEmpty() ? QChar(' ') : indicator.at(0);
+        } else if (name == QLatin1String("subfield")) {
+            QStringRef code = attributes.value("code");
+            if (!code.isEmpty()) {
+                builder.subfield(tag, ind2, code.at(0), reader.readElementText());
+            }
+        }
+    }
+    
+    if (reader.hasError()) {
+        return false;
+    }
+    
+    book = builder.book();
+    return true;
+}
@@ -0,0 +1,22 @@
+#ifndef MARCREADER_H
+#define MARCREADER_H
+
+#include <QByteArray>
+#include "database.h"
+
+// Maps bibliographic records in MARC 21 onto Book:
+//   245 $a title, 100/110/111/700 $a author, 020 $a ISBN,
+//   650/655 $a genre, 264/260 $c year (008/07-10 as a fallback)
+// Each function takes exactly one record and is safe to call from any
+// thread. They return false if the record cannot be decoded at all;
+// whether the resulting book is complete is up to the caller.
+class MarcReader
+{
+public:
+    // One ISO 2709 record, including its record terminator
+    static bool fromIso2709(const QByteArray &record, Book &book);
+    // One <record> element, with or without a namespace prefix
+    static bool fromMarcXml(const QByteArray &record, Book &book);
+};
+
+#endif // MARCREADER_H
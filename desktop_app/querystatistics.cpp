@@ -0,0 +1,246 @@
+#include "querystatistics.h"
+#include <QJsonArray>
+#include <QSqlError>
+#include <QVariant>
+#include <algorithm>
+
+// 100 us, 1 ms, 10 ms, 100 ms, 1 s
+const qint64 QueryStatistics::BucketLimitsNs[BucketCount - 1] = {
+    100000LL, 1000000LL, 10000000LL, 100000000LL, 1000000000LL
+};
+
+QueryStatistics& QueryStatistics::instance()
+{
+    static QueryStatistics instance;
+    return instance;
+}
+
+QueryStatistics::QueryStatistics()
+    : m_slowThresholdNs(100 * 1000000LL)
+    , m_slowHead(0)
+{
+}
+
+void QueryStatistics::setSlowThreshold(int milliseconds)
+{
+    QMutexLocker locker(&m_mutex);
+    m_slowThresholdNs = qint64(milliseconds) * 1000000LL;
+}
+
+int QueryStatistics::slowThreshold() const
+{
+    QMutexLocker locker(&m_mutex);
+    return int(m_slowThresholdNs / 1000000LL);
+}
+
+bool QueryStatistics::record(const QString &sql, qint64 elapsedNs, qint64 rows)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    Statement &statement = m_statements[sql];
+    if (statement.count == 0) {
+        statement.sql = sql;
+    }
+    statement.count++;
+    statement.totalNs += elapsedNs;
+    statement.maxNs = qMax(statement.maxNs, elapsedNs);
+    statement.rows += rows;
+    
+    int bucket = int(std::upper_bound(BucketLimitsNs, BucketLimitsNs + BucketCount - 1, elapsedNs) - BucketLimitsNs);
+    statement.buckets[bucket]++;
+    
+    if (elapsedNs < m_slowThresholdNs) {
+        return false;
+    }
+    
+    SlowQuery slow;
+    slow.sql = sql;
+    slow.elapsedNs = elapsedNs;
+    slow.rows = rows;
+    slow.at = QDateTime::currentDateTime();
+    if (m_slowQueries.size() < MaxSlowQueries) {
+        m_slowQueries.append(slow);
+    } else {
+        m_slowQueries[m_slowHead] = slow;
+        m_slowHead = (m_slowHead + 1) % MaxSlowQueries;
+    }
+    
+    if (m_plans.contains(sql)) {
+        return false;
+    }
+    m_plans.insert(sql, QString()); // claimed; filled in by attachPlan()
+    return true;
+}
+
+void QueryStatistics::attachPlan(const QString &sql, const QString &plan)
+{
+    QMutexLocker locker(&m_mutex);
+    m_plans.insert(sql, plan);
+}
+
+QVector<QueryStatistics::Statement> QueryStatistics::statements() const
+{
+    QMutexLocker locker(&m_mutex);
+    QVector<Statement> statements;
+    statements.reserve(m_statements.size());
+    for (const Statement &statement : m_statements) {
+        statements.append(statement);
+    }
+    
+    // Most total time first: that is where optimisation pays off
+    std::sort(statements.begin(), statements.end(), [](const Statement &a, const Statement &b) {
+        return a.totalNs > b.totalNs;
+    });
+    return statements;
+}
+
+QVector<QueryStatistics::SlowQuery> QueryStatistics::slowQueries() const
+{
+    QMutexLocker locker(&m_mutex);
+    // Oldest first
+    QVector<SlowQuery> slow = m_slowQueries.mid(m_slowHead);
+    slow += m_slowQueries.mid(0, m_slowHead);
+    return slow;
+}
+
+QString QueryStatistics::plan(const QString &sql) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_plans.value(sql);
+}
+
+QStringList QueryStatistics::bucketLabels()
+{
+    return {"<100us", "<1ms", "<10ms", "<100ms", "<1s", ">=1s"};
+}
+
+QJsonObject QueryStatistics::toJson() const
+{
+    const QStringList labels = bucketLabels();
+    
+    QJsonArray statementArray;
+    for (const Statement &statement : statements()) {
+        QJsonObject histogram;
+        for (int i = 0; i < BucketCount; ++i) {
+            histogram[labels[i]] = double(statement.buckets[i]);
+        }
+        
+        QJsonObject json;
+        json["sql"] = statement.sql;
+        json["count"] = double(statement.count);
+        json["totalMs"] = statement.totalNs / 1e6;
+        json["averageMs"] = statement.count ? statement.totalNs / 1e6 / statement.count : 0.0;
+        json["maxMs"] = statement.maxNs / 1e6;
+        json["rows"] = double(statement.rows);
+        json["histogram"] = histogram;
+        statementArray.append(json);
+    }
+    
+    QJsonArray slowArray;
+    for (const SlowQuery &slow : slowQueries()) {
+        QJsonObject json;
+        json["sql"] = slow.sql;
+        json["elapsedMs"] = slow.elapsedNs / 1e6;
+        json["rows"] = double(slow.rows);
+        json["at"] = slow.at.toString(Qt::ISODateWithMs);
+        json["plan"] = plan(slow.sql);
+        slowArray.append(json);
+    }
+    
+    QJsonObject root;
+    root["slowThresholdMs"] = slowThreshold();
+    root["statements"] = statementArray;
+    root["slowQueries"] = slowArray;
+    return root;
+}
+
+void QueryStatistics::reset()
+{
+    QMutexLocker locker(&m_mutex);
+    m_statements.clear();
+    m_slowQueries.clear();
+    m_slowHead = 0;
+    m_plans.clear();
+}
+
+QueryTrace::QueryTrace(const QSqlDatabase &database, QSqlQuery &query)
+    : m_database(database)
+    , m_query(query)
+    , m_elapsedNs(0)
+    , m_rows(0)
+    , m_executed(false)
+{
+}
+
+QueryTrace::~QueryTrace()
+{
+    if (!m_executed) {
+        return;
+    }
+    
+    QString sql = m_query.lastQuery().simplified();
+    if (QueryStatistics::instance().record(sql, m_elapsedNs, m_rows)) {
+        QueryStatistics::instance().attachPlan(sql, explain());
+    }
+}
+
+bool QueryTrace::exec()
+{
+    m_timer.start();
+    return finishExec(m_query.exec());
+}
+
+bool QueryTrace::exec(const QString &sql)
+{
+    m_timer.start();
+    return finishExec(m_query.exec(sql));
+}
+
+bool QueryTrace::next()
+{
+    m_timer.start();
+    bool row = m_query.next();
+    m_elapsedNs += m_timer.nsecsElapsed();
+    if (row) {
+        m_rows++;
+    }
+    return row;
+}
+
+bool QueryTrace::finishExec(bool success)
+{
+    m_elapsedNs += m_timer.nsecsElapsed();
+    m_executed = true;
+    // Reads count as they are stepped; writes by the rows they changed
+    if (success && !m_query.isSelect()) {
+        m_rows += qMax(0, m_query.numRowsAffected());
+    }
+    return success;
+}
+
+QString QueryTrace::explain() const
+{
+    // Same connection and the same bound values, so the plan is the one
+    // SQLite actually chose for the slow execution
+    QSqlQuery query(m_database);
+    if (!query.prepare("EXPLAIN QUERY PLAN " + m_query.lastQuery())) {
+        return query.lastError().text();
+    }
+    int count = m_query.boundValues().size();
+    for (int i = 0; i < count; ++i) {
+        query.bindValue(i, m_query.boundValue(i));
+    }
+    if (!query.exec()) {
+        return query.lastError().text();
+    }
+    
+    // Rows are (id, parent, notused, detail); indent by depth in the tree
+    QHash<int, int> depth;
+    QStringList lines;
+    while (query.next()) {
+        int level = depth.value(query.value(1).toInt(), -1) + 1;
+        depth.insert(query.value(0).toInt(), level);
+        lines << QString(level * 2, ' ') + query.value(3).toString();
+    }
+    return lines.join('\n');
+}
@@ -0,0 +1,102 @@
+#ifndef QUERYSTATISTICS_H
+#define QUERYSTATISTICS_H
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QMutex>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Process-wide timing for the statements run by every Database
+// connection: a latency histogram and row totals per statement, plus a
+// bounded log of executions slower than the threshold. The first slow
+// execution of each statement also records its EXPLAIN QUERY PLAN.
+class QueryStatistics
+{
+public:
+    // Upper bounds of the histogram buckets; the last bucket is open
+    static const int BucketCount = 6;
+    static const qint64 BucketLimitsNs[BucketCount - 1];
+    
+    struct Statement {
+        QString sql;
+        quint64 count = 0;
+        qint64 totalNs = 0;
+        qint64 maxNs = 0;
+        qint64 rows = 0;
+        quint64 buckets[BucketCount] = {};
+    };
+    
+    struct SlowQuery {
+        QString sql;
+        qint64 elapsedNs = 0;
+        qint64 rows = 0;
+        QDateTime at;
+    };
+    
+    static QueryStatistics& instance();
+    
+    void setSlowThreshold(int milliseconds);
+    int slowThreshold() const;
+    
+    // Returns true if this execution was slow and the statement has no
+    // plan yet; the caller should then capture one with attachPlan()
+    bool record(const QString &sql, qint64 elapsedNs, qint64 rows);
+    void attachPlan(const QString &sql, const QString &plan);
+    
+    QVector<Statement> statements() const;
+    QVector<SlowQuery> slowQueries() const;
+    QString plan(const QString &sql) const;
+    static QStringList bucketLabels();
+    
+    QJsonObject toJson() const;
+    void reset();
+
+private:
+    QueryStatistics();
+    QueryStatistics(const QueryStatistics&) = delete;
+    QueryStatistics& operator=(const QueryStatistics&) = delete;
+    
+    static const int MaxSlowQueries = 200;
+    
+    mutable QMutex m_mutex;
+    qint64 m_slowThresholdNs;
+    QHash<QString, Statement> m_statements;
+    QVector<SlowQuery> m_slowQueries; // ring, oldest at m_slowHead once full
+    int m_slowHead;
+    QHash<QString, QString> m_plans;
+};
+
+// Runs one statement and times only its exec() and next() calls, so work
+// done between steps, including other traced statements, is not charged
+// to it. Rows are those actually stepped, plus the rows a write changed.
+// Recorded once when the trace goes out of scope; repeated exec() calls,
+// as in a batch, add up.
+class QueryTrace
+{
+public:
+    QueryTrace(const QSqlDatabase &database, QSqlQuery &query);
+    ~QueryTrace();
+    
+    bool exec();
+    bool exec(const QString &sql);
+    bool next();
+
+private:
+    bool finishExec(bool success);
+    QString explain() const;
+    
+    QSqlDatabase m_database;
+    QSqlQuery &m_query;
+    QElapsedTimer m_timer;
+    qint64 m_elapsedNs;
+    qint64 m_rows;
+    bool m_executed;
+};
+
+#endif // QUERYSTATISTICS_H
@@ -0,0 +1,46 @@
+#include "startuptrace.h"
+#include <QDebug>
+#include <QElapsedTimer>
+
+namespace {
+
+struct TraceState {
+    QElapsedTimer clock;
+    qint64 last = 0;
+    bool enabled = false;
+    bool finished = false;
+    
+    TraceState()
+    {
+        clock.start();
+        enabled = qEnvironmentVariableIsSet("LIBRARY_STARTUP_TRACE");
+    }
+};
+
+// Started by the first mark(), which main() makes first thing
+TraceState &state()
+{
+    static TraceState trace;
+    return trace;
+}
+
+} // namespace
+
+void StartupTrace::mark(const QString &phase)
+{
+    TraceState &trace = state();
+    if (trace.finished || !trace.enabled) {
+        return;
+    }
+    
+    qint64 now = trace.clock.elapsed();
+    qDebug().noquote() << QString("[startup] %1 ms (+%2 ms) %3")
+                          .arg(now, 6).arg(now - trace.last, 5).arg(phase);
+    trace.last = now;
+}
+
+void StartupTrace::finish(const QString &phase)
+{
+    mark(phase);
+    state().finished = true;
+}
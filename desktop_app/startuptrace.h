@@ -0,0 +1,19 @@
+#ifndef STARTUPTRACE_H
+#define STARTUPTRACE_H
+
+#include <QString>
+
+// Timestamps the phases of application start-up. Output goes to the debug
+// log when LIBRARY_STARTUP_TRACE is set; marks after finish() are ignored,
+// so code that also runs later (e.g. statistics refreshes) can call it.
+class StartupTrace
+{
+public:
+    static void mark(const QString &phase);
+    static void finish(const QString &phase);
+
+private:
+    StartupTrace() = delete;
+};
+
+#endif // STARTUPTRACE_H
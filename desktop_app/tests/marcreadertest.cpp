@@ -0,0 +1,107 @@
+// MARC import tests. Records are assembled here rather than shipped as
+// files, so each test shows exactly the fields the reader sees.
+
+#include <QtTest>
+#include "../marcreader.h"
+
+class MarcReaderTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void isbnCheckDigits_data();
+    void isbnCheckDigits();
+    void iso2709WithIsbn10CheckX();
+    void marcXmlWithIsbn10CheckX();
+
+private:
+    static QByteArray subfield(char code, const QByteArray &value);
+    static QByteArray iso2709(const QList<QPair<QByteArray, QByteArray>> &fields);
+};
+
+QByteArray MarcReaderTest::subfield(char code, const QByteArray &value)
+{
+    return QByteArray(1, '\x1F') + code + value;
+}
+
+// A UTF-8 ISO 2709 record: leader, directory, then the fields
+QByteArray MarcReaderTest::iso2709(const QList<QPair<QByteArray, QByteArray>> &fields)
+{
+    QByteArray directory;
+    QByteArray data;
+    for (const auto &field : fields) {
+        QByteArray body = field.second + '\x1E';
+        directory += field.first
+                     + QByteArray::number(body.size()).rightJustified(4, '0')
+                     + QByteArray::number(data.size()).rightJustified(5, '0');
+        data += body;
+    }
+    directory += '\x1E';
+    data += '\x1D';
+
+    int baseAddress = 24 + directory.size();
+    QByteArray leader = QByteArray::number(baseAddress + data.size()).rightJustified(5, '0')
+                        + "nam a22"
+                        + QByteArray::number(baseAddress).rightJustified(5, '0')
+                        + " a 4500";
+    return leader + directory + data;
+}
+
+void MarcReaderTest::isbnCheckDigits_data()
+{
+    QTest::addColumn<QString>("isbn");
+    QTest::addColumn<bool>("valid");
+
+    QTest::newRow("isbn10") << "0262033844" << true;
+    QTest::newRow("isbn10 check X") << "080442957X" << true;
+    QTest::newRow("isbn10 check x") << "0-8044-2957-x" << true;
+    QTest::newRow("isbn10 wrong check") << "0804429579" << false;
+    QTest::newRow("X before the end") << "08044295X7" << false;
+    QTest::newRow("X with digits after") << "080442957X123" << false;
+    QTest::newRow("isbn13") << "9780262033848" << true;
+    QTest::newRow("isbn13 check X") << "978026203384X" << false;
+}
+
+void MarcReaderTest::isbnCheckDigits()
+{
+    QFETCH(QString, isbn);
+    QFETCH(bool, valid);
+    QCOMPARE(Book::isValidISBN(isbn), valid);
+}
+
+void MarcReaderTest::iso2709WithIsbn10CheckX()
+{
+    QByteArray record = iso2709({
+        {"008", "850327s1985    enk           000 1 eng d"},
+        {"020", "  " + subfield('a', "080442957X (pbk.)")},
+        {"100", "1 " + subfield('a', "Gray, Alasdair,")},
+        {"245", "10" + subfield('a', "Lanark :") + subfield('b', "a life in four books /")},
+    });
+
+    Book book;
+    QVERIFY(MarcReader::fromIso2709(record, book));
+    QCOMPARE(book.ISBN, QString("080442957X"));
+    QCOMPARE(book.title, QString("Lanark"));
+    QCOMPARE(book.author, QString("Gray, Alasdair"));
+    QCOMPARE(book.year, 1985);
+}
+
+void MarcReaderTest::marcXmlWithIsbn10CheckX()
+{
+    QByteArray record = R"(<marc:record>
+        <marc:datafield tag="020" ind1=" " ind2=" ">
+            <marc:subfield code="a">0-8044-2957-x</marc:subfield>
+        </marc:datafield>
+        <marc:datafield tag="245" ind1="1" ind2="0">
+            <marc:subfield code="a">Lanark /</marc:subfield>
+        </marc:datafield>
+    </marc:record>)";
+
+    Book book;
+    QVERIFY(MarcReader::fromMarcXml(record, book));
+    QCOMPARE(book.ISBN, QString("080442957X"));
+    QCOMPARE(book.title, QString("Lanark"));
+}
+
+QTEST_GUILESS_MAIN(MarcReaderTest)
+#include "marcreadertest.moc"
@@ -0,0 +1,295 @@
+// Delta and streaming update tests. Generates two fake builds, makes a
+// patch between them with make_update_patch.py and publishes both through
+// update_server.py on a free local port; the updater code then downloads
+// from it exactly as it would from the GitHub release feed. Needs python3
+// on PATH (the tests are skipped otherwise).
+
+#include <QtTest>
+#include <QCryptographicHash>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include "../updatedownloader.h"
+#include "../updatepatch.h"
+
+class UpdateTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanup();
+    
+    void applyPatch();
+    void rejectPatchForOtherBase();
+    void rejectPatchForOtherRelease();
+    void rejectDamagedPatch();
+    void downloadAndApplyPatch();
+    void resumeDroppedDownload();
+    void resumeStalledDownload();
+    void rejectWrongChecksum();
+
+private:
+    QString path(const QString &name) const { return m_dir.filePath(name); }
+    bool runTool(const QStringList &arguments);
+    QUrl startServer(const QStringList &arguments);
+    QJsonObject fetchFeed(const QUrl &feed);
+    QJsonObject findAsset(const QJsonObject &release, const QString &name);
+    bool download(const QUrl &url, const QString &target, const QByteArray &sha256, QString *error = nullptr);
+    static QByteArray digestOf(const QJsonObject &asset);
+    
+    QString m_python;
+    QTemporaryDir m_dir;
+    QByteArray m_base;
+    QByteArray m_target;
+    QByteArray m_targetSha256;
+    QNetworkAccessManager m_network;
+    QProcess *m_server = nullptr;
+};
+
+void UpdateTest::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    m_python = QStandardPaths::findExecutable("python3");
+    if (m_python.isEmpty()) {
+        QSKIP("python3 is needed to generate and serve patches");
+    }
+    
+    // A 3 MB "installed build" and a "new build" with an inserted block,
+    // a removed block and a rewritten region, as a rebuild would produce
+    QRandomGenerator random(2024);
+    m_base.resize(3 * 1024 * 1024);
+    for (int i = 0; i < m_base.size(); i += 4) {
+        quint32 word = random.generate();
+        memcpy(m_base.data() + i, &word, 4);
+    }
+    m_target = m_base;
+    m_target.insert(150000, QByteArray(7000, 'i'));
+    m_target.remove(2000000, 40000);
+    m_target.replace(900000, 300, QByteArray(300, 'r'));
+    m_target.append(QByteArray(5000, 't'));
+    m_targetSha256 = QCryptographicHash::hash(m_target, QCryptographicHash::Sha256).toHex();
+    
+    QFile base(path("base.AppImage"));
+    QVERIFY(base.open(QIODevice::WriteOnly) && base.write(m_base) == m_base.size());
+    base.close();
+    QFile target(path("target.AppImage"));
+    QVERIFY(target.open(QIODevice::WriteOnly) && target.write(m_target) == m_target.size());
+    target.close();
+    
+    QVERIFY(runTool({"make_update_patch.py", path("base.AppImage"), path("target.AppImage"),
+                     "-o", path("update.lmsdiff")}));
+    QVERIFY(QFileInfo(path("update.lmsdiff")).size() < m_target.size() / 10);
+}
+
+void UpdateTest::cleanup()
+{
+    if (m_server) {
+        m_server->kill();
+        m_server->waitForFinished();
+        delete m_server;
+        m_server = nullptr;
+    }
+    QFile::remove(path("patched.AppImage"));
+    QFile::remove(path("downloaded.AppImage"));
+    QFile::remove(path("downloaded.lmsdiff"));
+}
+
+bool UpdateTest::runTool(const QStringList &arguments)
+{
+    QStringList command = arguments;
+    command[0] = QDir(UPDATE_TOOLS_DIR).filePath(command[0]);
+    
+    QProcess tool;
+    tool.start(m_python, command);
+    if (!tool.waitForFinished(60000) || tool.exitCode() != 0) {
+        qWarning() << tool.readAllStandardOutput() << tool.readAllStandardError();
+        return false;
+    }
+    return true;
+}
+
+QUrl UpdateTest::startServer(const QStringList &arguments)
+{
+    m_server = new QProcess();
+    m_server->setProcessChannelMode(QProcess::MergedChannels);
+    m_server->start(m_python, QStringList{"-u", QDir(UPDATE_TOOLS_DIR).filePath("update_server.py"),
+                                          "--port", "0", "--file", path("target.AppImage"),
+                                          "--version", "9.9.9"} + arguments);
+    
+    // The server reports the port it picked on its "Feed:" line
+    QRegularExpression feedLine("Feed: (\\S+)");
+    QByteArray output;
+    while (m_server->waitForReadyRead(10000)) {
+        output += m_server->readAll();
+        QRegularExpressionMatch match = feedLine.match(QString::fromUtf8(output));
+        if (match.hasMatch()) {
+            return QUrl(match.captured(1));
+        }
+    }
+    qWarning() << "update_server.py did not start:" << output;
+    return QUrl();
+}
+
+QJsonObject UpdateTest::fetchFeed(const QUrl &feed)
+{
+    QNetworkReply *reply = m_network.get(QNetworkRequest(feed));
+    QSignalSpy finished(reply, &QNetworkReply::finished);
+    if (!finished.wait(10000)) {
+        return QJsonObject();
+    }
+    reply->deleteLater();
+    return QJsonDocument::fromJson(reply->readAll()).object();
+}
+
+QJsonObject UpdateTest::findAsset(const QJsonObject &release, const QString &name)
+{
+    for (const QJsonValue &asset : release["assets"].toArray()) {
+        if (asset.toObject()["name"].toString() == name) {
+            return asset.toObject();
+        }
+    }
+    return QJsonObject();
+}
+
+QByteArray UpdateTest::digestOf(const QJsonObject &asset)
+{
+    return asset["digest"].toString().mid(QString("sha256:").size()).toLatin1();
+}
+
+bool UpdateTest::download(const QUrl &url, const QString &target, const QByteArray &sha256, QString *error)
+{
+    UpdateDownloader downloader(&m_network);
+    QSignalSpy finished(&downloader, &UpdateDownloader::finished);
+    downloader.start(url, target, sha256);
+    if (finished.isEmpty() && !finished.wait(60000)) {
+        return false;
+    }
+    if (error) {
+        *error = finished.first().at(1).toString();
+    }
+    return finished.first().at(0).toBool();
+}
+
+void UpdateTest::applyPatch()
+{
+    QString error;
+    QVERIFY2(UpdatePatch::apply(path("base.AppImage"), path("update.lmsdiff"), path("patched.AppImage"),
+                                m_targetSha256, &error), qPrintable(error));
+    
+    QFile patched(path("patched.AppImage"));
+    QVERIFY(patched.open(QIODevice::ReadOnly));
+    QVERIFY(patched.readAll() == m_target);
+}
+
+void UpdateTest::rejectPatchForOtherBase()
+{
+    QByteArray other = m_base;
+    other[1000] = char(other[1000] ^ 0xff);
+    QFile base(path("other.AppImage"));
+    QVERIFY(base.open(QIODevice::WriteOnly));
+    base.write(other);
+    base.close();
+    
+    QString error;
+    QVERIFY(!UpdatePatch::apply(path("other.AppImage"), path("update.lmsdiff"), path("patched.AppImage"),
+                                m_targetSha256, &error));
+    QVERIFY(!error.isEmpty());
+    QVERIFY(!QFile::exists(path("patched.AppImage")));
+}
+
+void UpdateTest::rejectPatchForOtherRelease()
+{
+    QByteArray otherRelease = QCryptographicHash::hash("another build", QCryptographicHash::Sha256).toHex();
+    QVERIFY(!UpdatePatch::apply(path("base.AppImage"), path("update.lmsdiff"), path("patched.AppImage"),
+                                otherRelease));
+    QVERIFY(!QFile::exists(path("patched.AppImage")));
+}
+
+void UpdateTest::rejectDamagedPatch()
+{
+    QFile patch(path("update.lmsdiff"));
+    QVERIFY(patch.open(QIODevice::ReadOnly));
+    QByteArray truncated = patch.readAll();
+    truncated.chop(truncated.size() / 3);
+    
+    QFile damaged(path("damaged.lmsdiff"));
+    QVERIFY(damaged.open(QIODevice::WriteOnly));
+    damaged.write(truncated);
+    damaged.close();
+    
+    QVERIFY(!UpdatePatch::apply(path("base.AppImage"), path("damaged.lmsdiff"), path("patched.AppImage"),
+                                m_targetSha256));
+    QVERIFY(!QFile::exists(path("patched.AppImage")));
+}
+
+void UpdateTest::downloadAndApplyPatch()
+{
+    QUrl feed = startServer({"--patch", path("update.lmsdiff"), "--patch-from", "1.0.0"});
+    QVERIFY(feed.isValid());
+    
+    // Same lookup as UpdateDialog::parseUpdateInfo()
+    QJsonObject release = fetchFeed(feed);
+    QJsonObject package = findAsset(release, "LibraryManagementSystem-9.9.9.AppImage");
+    QJsonObject patch = findAsset(release, UpdatePatch::assetName("1.0.0", "9.9.9"));
+    QVERIFY(!patch.isEmpty());
+    QCOMPARE(digestOf(package), m_targetSha256);
+    
+    QString error;
+    QVERIFY2(download(QUrl(patch["browser_download_url"].toString()), path("downloaded.lmsdiff"),
+                      digestOf(patch), &error), qPrintable(error));
+    QVERIFY2(UpdatePatch::apply(path("base.AppImage"), path("downloaded.lmsdiff"), path("patched.AppImage"),
+                                digestOf(package), &error), qPrintable(error));
+    QCOMPARE(UpdateDownloader::sha256Of(path("patched.AppImage")), m_targetSha256);
+}
+
+void UpdateTest::resumeDroppedDownload()
+{
+    // The first two transfers stop after 1 MB each
+    QUrl feed = startServer({"--drop-after", "1000000", "--drops", "2"});
+    QVERIFY(feed.isValid());
+    
+    QJsonObject package = findAsset(fetchFeed(feed), "LibraryManagementSystem-9.9.9.AppImage");
+    QString error;
+    QVERIFY2(download(QUrl(package["browser_download_url"].toString()), path("downloaded.AppImage"),
+                      digestOf(package), &error), qPrintable(error));
+    QCOMPARE(UpdateDownloader::sha256Of(path("downloaded.AppImage")), m_targetSha256);
+    QVERIFY(!QFile::exists(UpdateDownloader::partialPath(path("downloaded.AppImage"))));
+}
+
+void UpdateTest::resumeStalledDownload()
+{
+    // The first transfer goes quiet after 1 MB but keeps the connection open
+    QUrl feed = startServer({"--drop-after", "1000000", "--stall", "60"});
+    QVERIFY(feed.isValid());
+    
+    QJsonObject package = findAsset(fetchFeed(feed), "LibraryManagementSystem-9.9.9.AppImage");
+    UpdateDownloader downloader(&m_network);
+    downloader.setStallTimeout(2000);
+    QSignalSpy finished(&downloader, &UpdateDownloader::finished);
+    downloader.start(QUrl(package["browser_download_url"].toString()), path("downloaded.AppImage"),
+                     digestOf(package));
+    QVERIFY(finished.wait(30000));
+    QVERIFY2(finished.first().at(0).toBool(), qPrintable(finished.first().at(1).toString()));
+    QCOMPARE(UpdateDownloader::sha256Of(path("downloaded.AppImage")), m_targetSha256);
+}
+
+void UpdateTest::rejectWrongChecksum()
+{
+    QUrl feed = startServer({"--digest", QString(64, '0')});
+    QVERIFY(feed.isValid());
+    
+    QJsonObject package = findAsset(fetchFeed(feed), "LibraryManagementSystem-9.9.9.AppImage");
+    QVERIFY(!download(QUrl(package["browser_download_url"].toString()), path("downloaded.AppImage"),
+                      digestOf(package)));
+    QVERIFY(!QFile::exists(path("downloaded.AppImage")));
+    QVERIFY(!QFile::exists(UpdateDownloader::partialPath(path("downloaded.AppImage"))));
+}
+
+QTEST_GUILESS_MAIN(UpdateTest)
+#include "updatetest.moc"
@@ -0,0 +1,193 @@
+#!/usr/bin/env python3
+
+"""Local stand-in for the GitHub release feed, for testing the updater.
+
+Serves a release JSON shaped like api.github.com/.../releases/latest for
+one package file, and the file itself with Range/If-Range support.
+--drop-after closes the connection part-way through the first download(s)
+so the resume path can be exercised; with --stall the connection is held
+open silently instead, as a dead network path would. --patch also publishes a delta from
+make_update_patch.py for the version given with --patch-from.
+
+    python3 update_server.py --file build/LibraryManagementSystem --version 9.9.9 --drop-after 1000000
+    LIBRARY_UPDATE_URL=http://127.0.0.1:8090/releases/latest ./LibraryManagementSystem
+
+--port 0 picks a free port; the "Feed:" line reports it.
+"""
+
+import argparse
+import hashlib
+import http.server
+import json
+import os
+import re
+import threading
+import time
+
+PORT = 8090
+CHUNK_SIZE = 64 * 1024
+
+
+def sha256_of(path):
+    digest = hashlib.sha256()
+    with open(path, 'rb') as f:
+        for chunk in iter(lambda: f.read(1024 * 1024), b''):
+            digest.update(chunk)
+    return digest.hexdigest()
+
+
+class UpdateRequestHandler(http.server.BaseHTTPRequestHandler):
+    # Set up by main(): asset name -> (path, SHA-256, ETag)
+    options = None
+    assets = {}
+    drops_left = 0
+    lock = threading.Lock()
+
+    def do_GET(self):
+        name = self.path[len('/download/'):] if self.path.startswith('/download/') else None
+        if self.path == '/releases/latest':
+            self.send_feed()
+        elif name in self.assets:
+            self.send_package(*self.assets[name])
+        else:
+            self.send_error(404)
+
+    def send_feed(self):
+        host = self.headers.get('Host')
+        assets = []
+        for name, (path, digest, _) in self.assets.items():
+            # --digest only replaces the package's checksum, not the patch's
+            if self.options.digest and path == self.options.file:
+                digest = self.options.digest
+            assets.append({
+                'name': name,
+                'size': os.path.getsize(path),
+                'digest': 'sha256:' + digest,
+                'browser_download_url': 'http://%s/download/%s' % (host, name),
+            })
+        release = {
+            'tag_name': 'v' + self.options.version,
+            'body': '<p>Test release served by update_server.py</p>',
+            'assets': assets,
+        }
+        body = json.dumps(release, indent=2).encode()
+        self.send_response(200)
+        self.send_header('Content-Type', 'application/json')
+        self.send_header('Content-Length', str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def requested_range(self, size):
+        """Returns the start offset asked for, None for the whole file, or -1 if unsatisfiable."""
+        header = self.headers.get('Range')
+        if not header:
+            return None
+        # If-Range: a stale validator means "send everything"
+        if_range = self.headers.get('If-Range')
+        if if_range and if_range != self.current_etag:
+            return None
+        match = re.fullmatch(r'bytes=(\d+)-', header.strip())
+        if not match:
+            return None
+        start = int(match.group(1))
+        return start if start < size else -1
+
+    def send_package(self, path, digest, etag):
+        self.current_etag = etag
+        size = os.path.getsize(path)
+        start = self.requested_range(size)
+
+        if start == -1:
+            self.send_response(416)
+            self.send_header('Content-Range', 'bytes */%d' % size)
+            self.send_header('Content-Length', '0')
+            self.end_headers()
+            return
+
+        if start is None:
+            start = 0
+            self.send_response(200)
+        else:
+            self.send_response(206)
+            self.send_header('Content-Range', 'bytes %d-%d/%d' % (start, size - 1, size))
+        self.send_header('Content-Type', 'application/octet-stream')
+        self.send_header('Content-Length', str(size - start))
+        self.send_header('ETag', etag)
+        self.send_header('Accept-Ranges', 'bytes')
+        self.end_headers()
+
+        with UpdateRequestHandler.lock:
+            drop = UpdateRequestHandler.drops_left > 0
+            if drop:
+                UpdateRequestHandler.drops_left -= 1
+        limit = start + self.options.drop_after if drop else size
+
+        with open(path, 'rb') as f:
+            f.seek(start)
+            offset = start
+            while offset < min(limit, size):
+                chunk = f.read(min(CHUNK_SIZE, limit - offset))
+                if not chunk:
+                    break
+                self.wfile.write(chunk)
+                offset += len(chunk)
+                if self.options.delay:
+                    time.sleep(self.options.delay)
+
+        if drop and offset < size and self.options.stall:
+            print(f"⏸️  Stalling at byte {offset} of {size} for {self.options.stall} s")
+            time.sleep(self.options.stall)
+
+        if drop and offset < size:
+            print(f"✂️  Dropped connection at byte {offset} of {size}")
+            self.close_connection = True
+            self.connection.shutdown(2)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Serve a test update for the Library Management System')
+    parser.add_argument('--file', required=True, help='package to serve as the update')
+    parser.add_argument('--version', default='9.9.9', help='version advertised in the feed')
+    parser.add_argument('--port', type=int, default=PORT)
+    parser.add_argument('--drop-after', type=int, default=0,
+                        help='close the connection after this many bytes of a download')
+    parser.add_argument('--drops', type=int, default=1, help='number of downloads to cut short')
+    parser.add_argument('--stall', type=float, default=0.0,
+                        help='seconds to hold a cut-short download open without sending before closing it')
+    parser.add_argument('--delay', type=float, default=0.0, help='seconds to sleep between 64 KiB chunks')
+    parser.add_argument('--digest', help='advertise this SHA-256 instead of the real one')
+    parser.add_argument('--patch', help='delta from make_update_patch.py to publish as well')
+    parser.add_argument('--patch-from', default='1.0.0', help='installed version the patch applies to')
+    options = parser.parse_args()
+
+    def add_asset(name, path):
+        digest = sha256_of(path)
+        UpdateRequestHandler.assets[name] = (path, digest, '"%s"' % digest[:16])
+
+    add_asset('LibraryManagementSystem-%s.AppImage' % options.version, options.file)
+    if options.patch:
+        add_asset('LibraryManagementSystem-%s-to-%s.lmsdiff' % (options.patch_from, options.version), options.patch)
+    UpdateRequestHandler.options = options
+    UpdateRequestHandler.drops_left = options.drops if options.drop_after > 0 else 0
+
+    httpd = http.server.ThreadingHTTPServer(('127.0.0.1', options.port), UpdateRequestHandler)
+    port = httpd.server_address[1]
+
+    print("🚀 Library Management System Update Server")
+    print("=" * 50)
+    for name, (path, digest, _) in UpdateRequestHandler.assets.items():
+        print(f"📦 {name}: {path} ({os.path.getsize(path)} bytes)")
+        print(f"   SHA-256 {digest}")
+    print(f"🌐 Feed: http://127.0.0.1:{port}/releases/latest")
+    print(f"💡 Run the app with LIBRARY_UPDATE_URL=http://127.0.0.1:{port}/releases/latest")
+    print("🛑 Press Ctrl+C to stop the server")
+    print("=" * 50, flush=True)
+
+    try:
+        httpd.serve_forever()
+    except KeyboardInterrupt:
+        print("\n🛑 Server stopped by user")
+
+
+if __name__ == "__main__":
+    main()
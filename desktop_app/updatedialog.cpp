@@ -1,4 +1,6 @@
 #include "updatedialog.h"
+#include "updatedownloader.h"
+#include "updatepatch.h"
 #include <QApplication>
 #include <QMessageBox>
 #include <QStandardPaths>
@@ -8,14 +10,24 @@
 #include <QUrl>
 #include <QFileInfo>
 #include <QVersionNumber>
+#include <QJsonArray>
+#include <QDebug>
+#include <QtConcurrent>
 
 UpdateDialog::UpdateDialog(QWidget *parent)
     : QDialog(parent)
     , m_networkManager(new QNetworkAccessManager(this))
     , m_currentReply(nullptr)
+    , m_downloader(new UpdateDownloader(m_networkManager, this))
+    , m_downloadStage(FullDownload)
     , m_updateAvailable(false)
 {
     setupUI();
+    
+    connect(m_downloader, &UpdateDownloader::progress, this, &UpdateDialog::onDownloadProgress);
+    connect(m_downloader, &UpdateDownloader::resumed, this, &UpdateDialog::onDownloadResumed);
+    connect(m_downloader, &UpdateDownloader::finished, this, &UpdateDialog::onDownloadFinished);
+    connect(&m_patchWatcher, &QFutureWatcher<QString>::finished, this, &UpdateDialog::onPatchApplied);
     setWindowTitle("Check for Updates");
     setModal(true);
     resize(500, 400);
@@ -75,13 +87,22 @@ void UpdateDialog::setupUI()
     connect(m_closeButton, &QPushButton::clicked, this, &QDialog::accept);
 }
 
+QUrl UpdateDialog::updateFeedUrl()
+{
+    QString url = qEnvironmentVariable("LIBRARY_UPDATE_URL");
+    if (url.isEmpty()) {
+        url = "https://api.github.com/repos/Konadu-Prince/CODSOFT-c-/releases/latest";
+    }
+    return QUrl(url);
+}
+
 void UpdateDialog::checkForUpdates()
 {
-    // In a real application, this would be your actual update server URL
-    // For demonstration, we'll use a mock JSON response
-    QUrl updateUrl("https://api.github.com/repos/Konadu-Prince/CODSOFT-c-/releases/latest");
+    if (m_downloader->isRunning()) {
+        return; // Keep the progress of a running download on screen
+    }
     
-    QNetworkRequest request(updateUrl);
+    QNetworkRequest request(updateFeedUrl());
     request.setHeader(QNetworkRequest::UserAgentHeader, "LibraryManagementSystem/1.0.0");
     
     m_currentReply = m_networkManager->get(request);
@@ -131,6 +152,8 @@ void UpdateDialog::parseUpdateInfo(const QByteArray &data)
     
     if (error.error != QJsonParseError::NoError) {
         // Mock update info for demonstration
+        m_sha256.clear();
+        m_patchUrl.clear();
         m_latestVersion = "1.1.0";
         m_downloadUrl = "https://github.com/Konadu-Prince/CODSOFT-c-/releases/download/v1.1.0/LibraryManagementSystem-1.1.0.AppImage";
         m_changelog = R"(
@@ -153,13 +176,28 @@ void UpdateDialog::parseUpdateInfo(const QByteArray &data)
     m_latestVersion = obj["tag_name"].toString().remove("v");
     
     // Get download URL for AppImage (Linux)
+    // GitHub publishes each asset's checksum as "digest": "sha256:<hex>"
+    auto sha256Of = [](const QJsonObject &asset) {
+        QString digest = asset["digest"].toString();
+        return digest.startsWith("sha256:") ? digest.mid(7).toLatin1() : QByteArray();
+    };
+    
+    // A release may also carry a delta from the installed version
+    QString patchName = UpdatePatch::assetName(getCurrentVersion(), m_latestVersion);
+    m_downloadUrl.clear();
+    m_sha256.clear();
+    m_patchUrl.clear();
+    m_patchSha256.clear();
     QJsonArray assets = obj["assets"].toArray();
     for (const QJsonValue &asset : assets) {
         QJsonObject assetObj = asset.toObject();
         QString name = assetObj["name"].toString();
-        if (name.contains("AppImage") || name.contains("exe") || name.contains("dmg")) {
+        if (name == patchName) {
+            m_patchUrl = assetObj["browser_download_url"].toString();
+            m_patchSha256 = sha256Of(assetObj);
+        } else if (m_downloadUrl.isEmpty() && (name.contains("AppImage") || name.contains("exe") || name.contains("dmg"))) {
             m_downloadUrl = assetObj["browser_download_url"].toString();
-            break;
+            m_sha256 = sha256Of(assetObj);
         }
     }
     
@@ -187,6 +225,22 @@ QString UpdateDialog::getCurrentVersion()
     return QApplication::applicationVersion();
 }
 
+QString UpdateDialog::downloadTargetPath() const
+{
+    QString downloadsPath = QStandardPaths::writableLocation(QStandardPaths::DownloadLocation);
+    QString fileName = QString("LibraryManagementSystem-%1").arg(m_latestVersion);
+    
+    if (m_downloadUrl.contains("AppImage")) {
+        fileName += ".AppImage";
+    } else if (m_downloadUrl.contains("exe")) {
+        fileName += ".exe";
+    } else if (m_downloadUrl.contains("dmg")) {
+        fileName += ".dmg";
+    }
+    
+    return QDir(downloadsPath).filePath(fileName);
+}
+
 void UpdateDialog::downloadUpdate()
 {
     if (m_downloadUrl.isEmpty()) {
@@ -196,17 +250,87 @@ void UpdateDialog::downloadUpdate()
     
     m_downloadButton->setEnabled(false);
     m_statusLabel->setText("Downloading update...");
+    m_statusLabel->setStyleSheet("font-weight: bold; color: #2a82da;");
     m_progressBar->setVisible(true);
     m_progressBar->setRange(0, 100);
+    m_progressBar->setValue(0);
     
-    QNetworkRequest request(m_downloadUrl);
-    request.setHeader(QNetworkRequest::UserAgentHeader, "LibraryManagementSystem/1.0.0");
+    // Streams to <target>.part and picks up where an earlier attempt stopped
+    m_downloadedFilePath = downloadTargetPath();
+    if (!m_sha256.isEmpty() && UpdateDownloader::sha256Of(m_downloadedFilePath) == m_sha256.toLower()) {
+        onDownloadFinished(true, QString()); // Already downloaded in an earlier session
+        return;
+    }
     
-    m_currentReply = m_networkManager->get(request);
-    connect(m_currentReply, &QNetworkReply::downloadProgress, this, &UpdateDialog::onDownloadProgress);
-    connect(m_currentReply, &QNetworkReply::finished, this, &UpdateDialog::onDownloadFinished);
-    connect(m_currentReply, QOverload<QNetworkReply::NetworkError>::of(&QNetworkReply::errorOccurred),
-            this, &UpdateDialog::onDownloadError);
+    // Prefer the delta when the release has one for the installed build
+    if (!m_patchUrl.isEmpty() && !m_patchSha256.isEmpty() && QFile::exists(installedPackagePath())) {
+        m_downloadStage = PatchDownload;
+        m_statusLabel->setText("Downloading update patch...");
+        m_downloader->start(QUrl(m_patchUrl), patchPath(), m_patchSha256);
+        return;
+    }
+    
+    startFullDownload();
+}
+
+void UpdateDialog::startFullDownload()
+{
+    m_downloadStage = FullDownload;
+    m_downloader->start(QUrl(m_downloadUrl), m_downloadedFilePath, m_sha256);
+}
+
+QString UpdateDialog::installedPackagePath()
+{
+    // AppImages run from a mount point; the runtime names the real file
+    return qEnvironmentVariable("APPIMAGE", QCoreApplication::applicationFilePath());
+}
+
+QString UpdateDialog::patchPath() const
+{
+    return m_downloadedFilePath + ".lmsdiff";
+}
+
+void UpdateDialog::applyPatch()
+{
+    m_statusLabel->setText("Applying update patch...");
+    m_progressBar->setVisible(true);
+    m_progressBar->setRange(0, 0);
+    
+    QString base = installedPackagePath();
+    QString patch = patchPath();
+    QString output = m_downloadedFilePath;
+    QByteArray sha256 = m_sha256;
+    m_patchWatcher.setFuture(QtConcurrent::run([base, patch, output, sha256]() {
+        QString error;
+        UpdatePatch::apply(base, patch, output, sha256, &error);
+        QFile::remove(patch);
+        return error;
+    }));
+}
+
+void UpdateDialog::onPatchApplied()
+{
+    QString error = m_patchWatcher.result();
+    if (!error.isEmpty()) {
+        fallBackToFullDownload(error);
+        return;
+    }
+    
+    m_downloadStage = FullDownload;
+    onDownloadFinished(true, QString());
+}
+
+void UpdateDialog::fallBackToFullDownload(const QString &reason)
+{
+    qDebug() << "Update patch not used:" << reason;
+    QFile::remove(patchPath());
+    QFile::remove(UpdateDownloader::partialPath(patchPath()));
+    
+    m_statusLabel->setText("Patch could not be applied; downloading the full update...");
+    m_progressBar->setRange(0, 100);
+    m_progressBar->setValue(0);
+    m_progressBar->setVisible(true);
+    startFullDownload();
 }
 
 void UpdateDialog::onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal)
@@ -215,51 +339,43 @@ void UpdateDialog::onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal)
         int progress = (int)((bytesReceived * 100) / bytesTotal);
         m_progressBar->setValue(progress);
         m_statusLabel->setText(QString("Downloading update... %1%").arg(progress));
+    } else {
+        m_progressBar->setRange(0, 0);
+        m_statusLabel->setText(QString("Downloading update... %1 MB").arg(bytesReceived / (1024 * 1024)));
     }
 }
 
-void UpdateDialog::onDownloadFinished()
+void UpdateDialog::onDownloadResumed(qint64 offset)
 {
-    m_progressBar->setVisible(false);
-    
-    if (m_currentReply->error() != QNetworkReply::NoError) {
-        m_statusLabel->setText("Download failed. Please try again later.");
-        m_statusLabel->setStyleSheet("font-weight: bold; color: #dc3545;");
-        m_downloadButton->setEnabled(true);
+    m_statusLabel->setText(QString("Resuming download from %1 MB...").arg(offset / (1024 * 1024)));
+}
+
+void UpdateDialog::onDownloadFinished(bool success, const QString &error)
+{
+    if (m_downloadStage == PatchDownload) {
+        if (success) {
+            applyPatch();
+        } else {
+            fallBackToFullDownload(error);
+        }
         return;
     }
     
-    // Save downloaded file
-    QString downloadsPath = QStandardPaths::writableLocation(QStandardPaths::DownloadLocation);
-    QString fileName = QString("LibraryManagementSystem-%1").arg(m_latestVersion);
-    
-    if (m_downloadUrl.contains("AppImage")) {
-        fileName += ".AppImage";
-    } else if (m_downloadUrl.contains("exe")) {
-        fileName += ".exe";
-    } else if (m_downloadUrl.contains("dmg")) {
-        fileName += ".dmg";
-    }
-    
-    m_downloadedFilePath = QDir(downloadsPath).filePath(fileName);
+    m_progressBar->setVisible(false);
     
-    QFile file(m_downloadedFilePath);
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(m_currentReply->readAll());
-        file.close();
-        
-        m_statusLabel->setText("Download completed! Ready to install.");
-        m_statusLabel->setStyleSheet("font-weight: bold; color: #28a745;");
-        m_installButton->setVisible(true);
-        m_downloadButton->setVisible(false);
-    } else {
-        m_statusLabel->setText("Failed to save downloaded file.");
+    if (!success) {
+        qDebug() << "Update download failed:" << error;
+        m_statusLabel->setText(QString("Download failed: %1").arg(error));
         m_statusLabel->setStyleSheet("font-weight: bold; color: #dc3545;");
+        m_downloadButton->setText("Resume Download");
         m_downloadButton->setEnabled(true);
+        return;
     }
     
-    m_currentReply->deleteLater();
-    m_currentReply = nullptr;
+    m_statusLabel->setText("Download completed and verified! Ready to install.");
+    m_statusLabel->setStyleSheet("font-weight: bold; color: #28a745;");
+    m_installButton->setVisible(true);
+    m_downloadButton->setVisible(false);
 }
 
 void UpdateDialog::onDownloadError(QNetworkReply::NetworkError error)
@@ -283,6 +399,18 @@ void UpdateDialog::installUpdate()
         return;
     }
     
+    // The file sat on disk since it was verified; check it again before running it
+    if (m_sha256.isEmpty() || UpdateDownloader::sha256Of(m_downloadedFilePath) != m_sha256.toLower()) {
+        QFile::remove(m_downloadedFilePath);
+        m_installButton->setVisible(false);
+        m_downloadButton->setText("Download Update");
+        m_downloadButton->setVisible(true);
+        m_downloadButton->setEnabled(true);
+        QMessageBox::warning(this, "Installation Error",
+                             "The downloaded update failed checksum verification and was removed.");
+        return;
+    }
+    
     int ret = QMessageBox::question(this, "Install Update",
                                    "The application will close to install the update. Continue?",
                                    QMessageBox::Yes | QMessageBox::No);
@@ -13,6 +13,9 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QTimer>
+#include <QFutureWatcher>
+
+class UpdateDownloader;
 
 class UpdateDialog : public QDialog
 {
@@ -21,11 +24,17 @@ class UpdateDialog : public QDialog
 public:
     explicit UpdateDialog(QWidget *parent = nullptr);
     void checkForUpdates();
+    
+    // GitHub's latest-release API unless LIBRARY_UPDATE_URL points elsewhere,
+    // e.g. at update_server.py for testing
+    static QUrl updateFeedUrl();
 
 private slots:
     void onUpdateCheckFinished();
     void onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
-    void onDownloadFinished();
+    void onDownloadResumed(qint64 offset);
+    void onDownloadFinished(bool success, const QString &error);
+    void onPatchApplied();
     void onDownloadError(QNetworkReply::NetworkError error);
     void downloadUpdate();
     void installUpdate();
@@ -36,9 +45,19 @@ private:
     void parseUpdateInfo(const QByteArray &data);
     bool isNewerVersion(const QString &remoteVersion);
     QString getCurrentVersion();
+    QString downloadTargetPath() const;
+    QString patchPath() const;
+    static QString installedPackagePath();
+    void startFullDownload();
+    void applyPatch();
+    void fallBackToFullDownload(const QString &reason);
     
     QNetworkAccessManager *m_networkManager;
     QNetworkReply *m_currentReply;
+    UpdateDownloader *m_downloader;
+    enum DownloadStage { FullDownload, PatchDownload };
+    DownloadStage m_downloadStage;
+    QFutureWatcher<QString> m_patchWatcher;
     
     // UI Components
     QLabel *m_statusLabel;
@@ -52,6 +71,9 @@ private:
     // Update info
     QString m_latestVersion;
     QString m_downloadUrl;
+    QByteArray m_sha256;
+    QString m_patchUrl;
+    QByteArray m_patchSha256;
     QString m_changelog;
     QString m_downloadedFilePath;
     bool m_updateAvailable;
@@ -0,0 +1,324 @@
+#include "updatedownloader.h"
+#include <QDebug>
+#include <QNetworkRequest>
+#include <QRegularExpression>
+#include <QTimer>
+
+UpdateDownloader::UpdateDownloader(QNetworkAccessManager *manager, QObject *parent)
+    : QObject(parent)
+    , m_manager(manager)
+    , m_reply(nullptr)
+    , m_hash(QCryptographicHash::Sha256)
+    , m_received(0)
+    , m_total(-1)
+    , m_attempts(0)
+    , m_bodyStarted(false)
+    , m_resumedSession(false)
+    , m_restartPending(false)
+    , m_stallTimer(new QTimer(this))
+    , m_stalled(false)
+{
+    m_stallTimer->setSingleShot(true);
+    m_stallTimer->setInterval(DefaultStallTimeout);
+    connect(m_stallTimer, &QTimer::timeout, this, &UpdateDownloader::onStalled);
+}
+
+UpdateDownloader::~UpdateDownloader()
+{
+    if (m_reply) {
+        // The partial file stays on disk for the next session
+        m_reply->disconnect(this);
+        m_reply->abort();
+        m_reply->deleteLater();
+    }
+}
+
+QString UpdateDownloader::partialPath(const QString &targetPath)
+{
+    return targetPath + ".part";
+}
+
+QByteArray UpdateDownloader::sha256Of(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    if (!hash.addData(&file)) {
+        return QByteArray();
+    }
+    return hash.result().toHex();
+}
+
+void UpdateDownloader::start(const QUrl &url, const QString &targetPath, const QByteArray &expectedSha256)
+{
+    if (isRunning()) {
+        return;
+    }
+    
+    if (expectedSha256.isEmpty()) {
+        emit finished(false, "The release does not publish a SHA-256 checksum");
+        return;
+    }
+    
+    m_url = url;
+    m_targetPath = targetPath;
+    m_expected = expectedSha256.toLower();
+    m_validator.clear();
+    m_total = -1;
+    m_attempts = 0;
+    m_restartPending = false;
+    m_error.clear();
+    
+    m_file.close();
+    m_file.setFileName(partialPath(targetPath));
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        emit finished(false, QString("Cannot write %1: %2").arg(m_file.fileName(), m_file.errorString()));
+        return;
+    }
+    
+    // Bytes left by an earlier session are hashed once, then the rest is
+    // requested from where they stop
+    m_hash.reset();
+    if (!m_hash.addData(&m_file)) {
+        m_file.resize(0);
+        m_hash.reset();
+    }
+    m_received = m_file.size();
+    m_file.seek(m_received);
+    m_resumedSession = m_received > 0;
+    if (m_resumedSession) {
+        emit resumed(m_received);
+    }
+    
+    request();
+}
+
+void UpdateDownloader::request()
+{
+    QNetworkRequest request(m_url);
+    request.setHeader(QNetworkRequest::UserAgentHeader, "LibraryManagementSystem/1.0.0");
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+    if (m_received > 0) {
+        request.setRawHeader("Range", "bytes=" + QByteArray::number(m_received) + "-");
+        // Without a validator a changed file is caught by the checksum
+        if (!m_validator.isEmpty()) {
+            request.setRawHeader("If-Range", m_validator);
+        }
+    }
+    
+    m_bodyStarted = false;
+    m_stalled = false;
+    m_reply = m_manager->get(request);
+    // Bounds memory use if the disk is slower than the network
+    m_reply->setReadBufferSize(ReadBufferSize);
+    connect(m_reply, &QNetworkReply::readyRead, this, &UpdateDownloader::onReadyRead);
+    connect(m_reply, &QNetworkReply::finished, this, &UpdateDownloader::onFinished);
+    // Covers connecting and waiting for headers as well as the body
+    m_stallTimer->start();
+}
+
+bool UpdateDownloader::beginBody()
+{
+    int status = m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status != 200 && status != 206) {
+        return false; // Error page; onFinished() reports it
+    }
+    
+    // Strong validators only; If-Range ignores weak ETags
+    QByteArray etag = m_reply->rawHeader("ETag");
+    m_validator = etag.startsWith("W/") ? m_reply->rawHeader("Last-Modified") : etag;
+    
+    if (status == 206) {
+        static const QRegularExpression contentRange("^bytes (\\d+)-(\\d+)/(\\d+|\\*)$");
+        QRegularExpressionMatch match = contentRange.match(QString::fromLatin1(m_reply->rawHeader("Content-Range")));
+        if (!match.hasMatch() || match.captured(1).toLongLong() != m_received) {
+            // Not the range we asked for; start over rather than guess
+            m_restartPending = true;
+            m_reply->abort();
+            return false;
+        }
+        m_total = match.captured(3) == "*" ? -1 : match.captured(3).toLongLong();
+    } else {
+        // Range ignored, or If-Range found a different file
+        if (m_received > 0) {
+            m_file.resize(0);
+            m_file.seek(0);
+            m_hash.reset();
+            m_received = 0;
+            m_resumedSession = false;
+        }
+        m_total = m_reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+        if (m_total <= 0) {
+            m_total = -1;
+        }
+    }
+    
+    m_bodyStarted = true;
+    return true;
+}
+
+bool UpdateDownloader::writeAvailable()
+{
+    QByteArray chunk = m_reply->readAll();
+    if (chunk.isEmpty()) {
+        return true;
+    }
+    
+    if (m_file.write(chunk) != chunk.size()) {
+        m_error = QString("Cannot write %1: %2").arg(m_file.fileName(), m_file.errorString());
+        m_reply->abort();
+        return false;
+    }
+    
+    m_hash.addData(chunk);
+    m_received += chunk.size();
+    m_attempts = 0; // Progress was made; a later drop gets fresh retries
+    emit progress(m_received, m_total);
+    return true;
+}
+
+void UpdateDownloader::onReadyRead()
+{
+    m_stallTimer->start();
+    QNetworkReply *reply = m_reply;
+    if (!m_bodyStarted && !beginBody()) {
+        reply->readAll(); // Discard, or the read buffer stalls the reply
+        return;
+    }
+    writeAvailable();
+}
+
+void UpdateDownloader::onFinished()
+{
+    m_stallTimer->stop();
+    int status = m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    QNetworkReply::NetworkError error = m_reply->error();
+    QString errorString = m_reply->errorString();
+    if (m_stalled) {
+        // abort() reports OperationCanceledError; retry it as a timeout
+        error = QNetworkReply::TimeoutError;
+        errorString = QString("No data received for %1 seconds").arg(m_stallTimer->interval() / 1000);
+    }
+    
+    if (!m_restartPending && m_error.isEmpty() && (m_bodyStarted || beginBody())) {
+        writeAvailable();
+    }
+    
+    m_reply->deleteLater();
+    m_reply = nullptr;
+    
+    if (!m_error.isEmpty()) {
+        fail(m_error);
+        return;
+    }
+    
+    if (m_restartPending) {
+        m_restartPending = false;
+        QTimer::singleShot(0, this, &UpdateDownloader::restart);
+        return;
+    }
+    
+    // The partial file already held every byte
+    if (status == 416 && m_received > 0) {
+        verify();
+        return;
+    }
+    
+    if (error != QNetworkReply::NoError) {
+        if (retryable(error) && ++m_attempts < MaxAttempts) {
+            qDebug() << "Update download interrupted at" << m_received << "bytes:" << errorString
+                     << "- resuming, attempt" << m_attempts + 1;
+            m_file.flush();
+            QTimer::singleShot(1000 * m_attempts, this, &UpdateDownloader::request);
+            return;
+        }
+        fail(errorString);
+        return;
+    }
+    
+    if (!m_bodyStarted) {
+        fail(QString("Unexpected HTTP status %1").arg(status));
+        return;
+    }
+    
+    verify();
+}
+
+void UpdateDownloader::onStalled()
+{
+    if (m_reply) {
+        m_stalled = true;
+        m_reply->abort();
+    }
+}
+
+void UpdateDownloader::restart()
+{
+    if (!m_file.isOpen() && !m_file.open(QIODevice::ReadWrite)) {
+        fail(QString("Cannot write %1: %2").arg(m_file.fileName(), m_file.errorString()));
+        return;
+    }
+    
+    m_file.resize(0);
+    m_file.seek(0);
+    m_hash.reset();
+    m_received = 0;
+    m_total = -1;
+    m_validator.clear();
+    m_resumedSession = false;
+    request();
+}
+
+void UpdateDownloader::verify()
+{
+    m_file.close();
+    
+    QByteArray actual = m_hash.result().toHex();
+    if (actual != m_expected) {
+        QFile::remove(m_file.fileName());
+        if (m_resumedSession) {
+            // The earlier session's bytes may belong to another build
+            qDebug() << "Resumed update failed verification; downloading again";
+            restart();
+            return;
+        }
+        fail(QString("Checksum mismatch: expected %1, got %2")
+             .arg(QString::fromLatin1(m_expected), QString::fromLatin1(actual)));
+        return;
+    }
+    
+    QFile::remove(m_targetPath);
+    if (!QFile::rename(m_file.fileName(), m_targetPath)) {
+        fail(QString("Cannot move the download to %1").arg(m_targetPath));
+        return;
+    }
+    
+    emit finished(true, QString());
+}
+
+void UpdateDownloader::fail(const QString &error)
+{
+    m_file.close();
+    m_error.clear();
+    emit finished(false, error);
+}
+
+bool UpdateDownloader::retryable(QNetworkReply::NetworkError error) const
+{
+    switch (error) {
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::NetworkSessionFailedError:
+    case QNetworkReply::ProxyConnectionClosedError:
+    case QNetworkReply::ProxyTimeoutError:
+    case QNetworkReply::ServiceUnavailableError:
+    case QNetworkReply::UnknownNetworkError:
+        return true;
+    default:
+        return false;
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef UPDATEDOWNLOADER_H
+#define UPDATEDOWNLOADER_H
+
+#include <QObject>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QTimer>
+#include <QUrl>
+
+// Downloads an update package straight to "<target>.part", hashing each
+// chunk as it arrives. An interrupted download is resumed with an HTTP
+// Range request, both after dropped connections and in later sessions;
+// the target file only appears once its SHA-256 matches the published one.
+// A connection that stays open but stops delivering data is aborted after
+// the stall timeout and resumed like a dropped one.
+class UpdateDownloader : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int MaxAttempts = 5;
+    static const qint64 ReadBufferSize = 1024 * 1024;
+    static const int DefaultStallTimeout = 30000; // ms without any data
+    
+    explicit UpdateDownloader(QNetworkAccessManager *manager, QObject *parent = nullptr);
+    ~UpdateDownloader();
+    
+    static QString partialPath(const QString &targetPath);
+    // Hex digest of a file, read in chunks; empty if it cannot be read
+    static QByteArray sha256Of(const QString &path);
+    
+    void setStallTimeout(int msecs) { m_stallTimer->setInterval(msecs); }
+    bool isRunning() const { return m_reply != nullptr; }
+    // expectedSha256 is the hex digest published with the release
+    void start(const QUrl &url, const QString &targetPath, const QByteArray &expectedSha256);
+
+signals:
+    void progress(qint64 received, qint64 total);
+    void resumed(qint64 offset);
+    // On failure the partial file is kept for the next attempt unless it
+    // failed verification
+    void finished(bool success, const QString &error);
+
+private slots:
+    void onReadyRead();
+    void onFinished();
+    void onStalled();
+
+private:
+    void request();
+    bool beginBody();
+    bool writeAvailable();
+    void restart();
+    void verify();
+    void fail(const QString &error);
+    bool retryable(QNetworkReply::NetworkError error) const;
+    
+    QNetworkAccessManager *m_manager;
+    QNetworkReply *m_reply;
+    QUrl m_url;
+    QString m_targetPath;
+    QByteArray m_expected;
+    QFile m_file;
+    QCryptographicHash m_hash;
+    QByteArray m_validator;     // ETag or Last-Modified, sent as If-Range
+    qint64 m_received;          // bytes in the partial file
+    qint64 m_total;
+    int m_attempts;
+    bool m_bodyStarted;
+    bool m_resumedSession;      // started from a previous session's file
+    bool m_restartPending;      // reply aborted to start from byte zero
+    QString m_error;            // local failure that aborted the reply
+    QTimer *m_stallTimer;       // restarted whenever data arrives
+    bool m_stalled;             // reply aborted by m_stallTimer
+};
+
+#endif // UPDATEDOWNLOADER_H
@@ -0,0 +1,143 @@
+#include "updatepatch.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+
+namespace {
+
+const char Magic[] = "LMSDIFF1";
+const int DigestSize = 32;
+enum Operation { End = 0, Copy = 1, Insert = 2 };
+
+// qCompress() payload for at most ChunkSize bytes, plus zlib overhead
+const quint32 MaxInsertPayload = UpdatePatch::ChunkSize + UpdatePatch::ChunkSize / 8 + 1024;
+
+bool setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+    return false;
+}
+
+} // namespace
+
+QString UpdatePatch::assetName(const QString &fromVersion, const QString &toVersion)
+{
+    return QString("LibraryManagementSystem-%1-to-%2.lmsdiff").arg(fromVersion, toVersion);
+}
+
+bool UpdatePatch::apply(const QString &basePath, const QString &patchPath, const QString &outputPath,
+                        const QByteArray &expectedSha256, QString *error)
+{
+    QFile patch(patchPath);
+    if (!patch.open(QIODevice::ReadOnly)) {
+        return setError(error, QString("Cannot read patch: %1").arg(patch.errorString()));
+    }
+    
+    QDataStream in(&patch);
+    in.setByteOrder(QDataStream::LittleEndian);
+    
+    QByteArray magic(8, Qt::Uninitialized);
+    QByteArray baseDigest(DigestSize, Qt::Uninitialized);
+    QByteArray targetDigest(DigestSize, Qt::Uninitialized);
+    quint64 baseSize = 0;
+    quint64 targetSize = 0;
+    in.readRawData(magic.data(), magic.size());
+    in >> baseSize;
+    in.readRawData(baseDigest.data(), DigestSize);
+    in >> targetSize;
+    in.readRawData(targetDigest.data(), DigestSize);
+    if (in.status() != QDataStream::Ok || magic != Magic) {
+        return setError(error, "Not an update patch");
+    }
+    
+    // Cheap checks first: the patch must produce the published build...
+    if (targetDigest.toHex() != expectedSha256.toLower()) {
+        return setError(error, "Patch does not produce the published release");
+    }
+    
+    // ...from the build that is actually installed
+    QFile base(basePath);
+    if (!base.open(QIODevice::ReadOnly)) {
+        return setError(error, QString("Cannot read installed package: %1").arg(base.errorString()));
+    }
+    if (quint64(base.size()) != baseSize) {
+        return setError(error, "Patch was made for a different installed package");
+    }
+    QCryptographicHash baseHash(QCryptographicHash::Sha256);
+    if (!baseHash.addData(&base) || baseHash.result() != baseDigest) {
+        return setError(error, "Patch was made for a different installed package");
+    }
+    
+    QSaveFile output(outputPath);
+    if (!output.open(QIODevice::WriteOnly)) {
+        return setError(error, QString("Cannot write %1: %2").arg(outputPath, output.errorString()));
+    }
+    
+    QCryptographicHash targetHash(QCryptographicHash::Sha256);
+    quint64 written = 0;
+    auto emitBytes = [&](const QByteArray &data) {
+        if (written + quint64(data.size()) > targetSize || output.write(data) != data.size()) {
+            return false;
+        }
+        targetHash.addData(data);
+        written += data.size();
+        return true;
+    };
+    
+    for (;;) {
+        quint8 operation = End;
+        in >> operation;
+        if (in.status() != QDataStream::Ok) {
+            return setError(error, "Patch is truncated");
+        }
+        
+        if (operation == End) {
+            break;
+        }
+        
+        if (operation == Copy) {
+            quint64 offset = 0;
+            quint64 length = 0;
+            in >> offset >> length;
+            if (in.status() != QDataStream::Ok || offset > baseSize || length > baseSize - offset
+                    || !base.seek(offset)) {
+                return setError(error, "Patch copies outside the installed package");
+            }
+            while (length > 0) {
+                QByteArray chunk = base.read(qMin<quint64>(length, ChunkSize));
+                if (chunk.isEmpty() || !emitBytes(chunk)) {
+                    return setError(error, "Failed to write the patched package");
+                }
+                length -= chunk.size();
+            }
+        } else if (operation == Insert) {
+            quint32 size = 0;
+            in >> size;
+            if (in.status() != QDataStream::Ok || size > MaxInsertPayload) {
+                return setError(error, "Patch is damaged");
+            }
+            QByteArray payload(size, Qt::Uninitialized);
+            if (in.readRawData(payload.data(), size) != int(size)) {
+                return setError(error, "Patch is truncated");
+            }
+            QByteArray data = qUncompress(payload);
+            if (data.isEmpty() || !emitBytes(data)) {
+                return setError(error, "Patch is damaged");
+            }
+        } else {
+            return setError(error, QString("Unknown patch operation %1").arg(operation));
+        }
+    }
+    
+    if (written != targetSize || targetHash.result() != targetDigest) {
+        return setError(error, "Patched package does not match the release checksum");
+    }
+    
+    if (!output.commit()) {
+        return setError(error, QString("Cannot write %1: %2").arg(outputPath, output.errorString()));
+    }
+    return true;
+}
@@ -0,0 +1,26 @@
+#ifndef UPDATEPATCH_H
+#define UPDATEPATCH_H
+
+#include <QByteArray>
+#include <QString>
+
+// Applies a binary delta written by make_update_patch.py to the installed
+// package. The base file, the patch and the output are streamed through
+// ChunkSize buffers, and the output is only committed when its SHA-256
+// matches both the patch header and the release's published checksum.
+class UpdatePatch
+{
+public:
+    static const qint64 ChunkSize = 1024 * 1024;
+    
+    // Asset name the release feed uses for a patch between two versions
+    static QString assetName(const QString &fromVersion, const QString &toVersion);
+    // Blocking; run it off the GUI thread
+    static bool apply(const QString &basePath, const QString &patchPath, const QString &outputPath,
+                      const QByteArray &expectedSha256, QString *error = nullptr);
+
+private:
+    UpdatePatch() = delete;
+};
+
+#endif // UPDATEPATCH_H
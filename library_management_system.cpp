@@ -4,6 +4,19 @@
 #include <algorithm>
 #include <iomanip>
 #include <limits>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <cstdio>
+#include <ctime>
+#include <cstring>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <sys/uio.h>
+#include <unistd.h>
 
 using namespace std;
 
@@ -17,6 +30,218 @@ struct Book {
     int year;
 };
 
+// Circulation event recorded in the audit trail
+struct AuditEvent {
+    time_t timestamp;
+    string action;
+    string ISBN;
+    string borrower;
+};
+
+// Audit trail for checkouts and returns. Callers only pay a lock-free
+// enqueue into a bounded multi-producer ring; a background thread appends
+// the events to a size-rotated log file.
+class AuditLog {
+public:
+    explicit AuditLog(const string& path) : path(path), enqueuePos(0), dequeuePos(0), running(true) {
+        for (size_t i = 0; i < CAPACITY; i++) {
+            ring[i].sequence.store(i, memory_order_relaxed);
+        }
+        writer = thread(&AuditLog::writerLoop, this);
+    }
+
+    ~AuditLog() {
+        running.store(false, memory_order_release);
+        writer.join();
+    }
+
+    // Returns false (and drops the event) if the ring is full
+    bool record(const string& action, const string& ISBN, const string& borrower) {
+        size_t pos = enqueuePos.load(memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &ring[pos & (CAPACITY - 1)];
+            size_t seq = slot->sequence.load(memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos.load(memory_order_relaxed);
+            }
+        }
+        slot->event.timestamp = time(nullptr);
+        slot->event.action = action;
+        slot->event.ISBN = ISBN;
+        slot->event.borrower = borrower;
+        slot->sequence.store(pos + 1, memory_order_release);
+        return true;
+    }
+
+private:
+    static const size_t CAPACITY = 1024; // must be a power of two
+    static const long MAX_FILE_SIZE = 1024 * 1024;
+
+    struct Slot {
+        atomic<size_t> sequence;
+        AuditEvent event;
+    };
+
+    bool dequeue(AuditEvent& event) {
+        size_t pos = dequeuePos;
+        Slot& slot = ring[pos & (CAPACITY - 1)];
+        if (slot.sequence.load(memory_order_acquire) != pos + 1) {
+            return false;
+        }
+        event = slot.event;
+        dequeuePos = pos + 1;
+        slot.sequence.store(pos + CAPACITY, memory_order_release);
+        return true;
+    }
+
+    void writerLoop() {
+        ofstream out(path.c_str(), ios::app);
+        AuditEvent event;
+        bool keepRunning = true;
+        while (keepRunning) {
+            // Drain whatever is left after shutdown before exiting
+            keepRunning = running.load(memory_order_acquire);
+            bool wrote = false;
+            while (dequeue(event)) {
+                if (out.tellp() >= MAX_FILE_SIZE) {
+                    out.close();
+                    rename(path.c_str(), (path + ".1").c_str());
+                    out.open(path.c_str(), ios::app);
+                }
+                out << event.timestamp << '\t' << event.action << '\t'
+                    << event.ISBN << '\t' << event.borrower << '\n';
+                wrote = true;
+            }
+            if (wrote) {
+                out.flush();
+            } else if (keepRunning) {
+                this_thread::sleep_for(chrono::milliseconds(50));
+            }
+        }
+    }
+
+    string path;
+    Slot ring[CAPACITY];
+    atomic<size_t> enqueuePos;
+    size_t dequeuePos; // only touched by the writer thread
+    atomic<bool> running;
+    thread writer;
+};
+
+// Counting Bloom filter over the ISBNs in the library, so that adding a
+// book only scans the catalog when the ISBN might already be there. A
+// negative answer is definite; 4-bit counts would do, but a byte per
+// counter keeps it simple at this size. Counters that hit 255 stay there.
+class IsbnFilter {
+public:
+    IsbnFilter() : capacity(0), hashes(1), items(0), lookups(0), possibleHits(0), falsePositives(0) {}
+
+    void rebuild(const vector<Book>& library) {
+        // Room for the catalog to double before the rate drifts above 1%
+        capacity = max<size_t>(1024, library.size() * 2);
+        double ln2 = log(2.0);
+        size_t slots = (size_t)ceil(-(double)capacity * log(TARGET_FALSE_POSITIVE_RATE) / (ln2 * ln2));
+        hashes = max(1, min(16, (int)lround((double)slots / capacity * ln2)));
+        counters.assign(slots, 0);
+        items = 0;
+        for (const Book& book : library) {
+            insert(book.ISBN);
+        }
+    }
+
+    bool mightContain(const string& ISBN) {
+        lookups++;
+        size_t first, step;
+        probe(ISBN, first, step);
+        for (int i = 0; i < hashes; i++) {
+            if (counters[(first + i * step) % counters.size()] == 0) {
+                return false;
+            }
+        }
+        possibleHits++;
+        return true;
+    }
+
+    // Call when the catalog did not confirm a possible hit
+    void recordFalsePositive() {
+        falsePositives++;
+    }
+
+    void insert(const string& ISBN) {
+        size_t first, step;
+        probe(ISBN, first, step);
+        for (int i = 0; i < hashes; i++) {
+            uint8_t& count = counters[(first + i * step) % counters.size()];
+            if (count < UINT8_MAX) {
+                count++;
+            }
+        }
+        items++;
+    }
+
+    // Only for ISBNs that were inserted
+    void remove(const string& ISBN) {
+        size_t first, step;
+        probe(ISBN, first, step);
+        for (int i = 0; i < hashes; i++) {
+            uint8_t& count = counters[(first + i * step) % counters.size()];
+            if (count > 0 && count < UINT8_MAX) {
+                count--;
+            }
+        }
+        items--;
+    }
+
+    bool needsRebuild() const {
+        return items > capacity;
+    }
+
+    size_t lookupCount() const { return lookups; }
+    size_t falsePositiveCount() const { return falsePositives; }
+
+    // Among lookups of ISBNs that turned out not to be in the library
+    double observedFalsePositiveRate() const {
+        size_t absent = lookups - possibleHits + falsePositives;
+        return absent > 0 ? (double)falsePositives / absent : 0.0;
+    }
+
+    double expectedFalsePositiveRate() const {
+        if (items == 0) {
+            return 0.0;
+        }
+        return pow(1.0 - exp(-(double)hashes * items / counters.size()), hashes);
+    }
+
+private:
+    static constexpr double TARGET_FALSE_POSITIVE_RATE = 0.01;
+
+    // Double hashing: all k probes come from one 64-bit hash
+    void probe(const string& ISBN, size_t& first, size_t& step) const {
+        uint64_t h = hash<string>()(ISBN);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        first = (size_t)(h & 0xffffffffu);
+        step = (size_t)(h >> 32) | 1;
+    }
+
+    vector<uint8_t> counters;
+    size_t capacity;
+    int hashes;
+    size_t items;
+    size_t lookups;
+    size_t possibleHits;
+    size_t falsePositives;
+};
+
 // Function to clear input buffer
 void clearInputBuffer() {
     cin.clear();
@@ -36,33 +261,360 @@ bool isValidISBN(const string& isbn) {
     return true;
 }
 
-// Function to display all books
+// Output buffer for catalog views and exports. Fields are formatted by
+// hand into one large reusable arena; long fields that need no escaping are
+// referenced in place, and everything is handed to the kernel with writev.
+class CatalogWriter {
+public:
+    explicit CatalogWriter(int fd) : fd(fd), arena(ARENA_SIZE), arenaUsed(0), segmentStart(0), iovCount(0), failed(false) {}
+
+    ~CatalogWriter() {
+        flush();
+    }
+
+    bool good() const {
+        return !failed;
+    }
+
+    void put(char c) {
+        if (arenaUsed == arena.size()) {
+            flush();
+        }
+        arena[arenaUsed++] = c;
+    }
+
+    void put(const char* data, size_t length) {
+        while (length > 0) {
+            if (arenaUsed == arena.size()) {
+                flush();
+            }
+            size_t n = min(length, arena.size() - arenaUsed);
+            memcpy(&arena[arenaUsed], data, n);
+            arenaUsed += n;
+            data += n;
+            length -= n;
+        }
+    }
+
+    void put(const char* text) {
+        put(text, strlen(text));
+    }
+
+    void put(const string& text) {
+        put(text.data(), text.size());
+    }
+
+    // Long strings are referenced in place instead of copied, so text must
+    // stay alive and unchanged until the next flush (catalog fields do)
+    void putStable(const string& text) {
+        if (text.size() >= ZERO_COPY_THRESHOLD) {
+            closeSegment();
+            pushIov(text.data(), text.size());
+        } else {
+            put(text.data(), text.size());
+        }
+    }
+
+    void putInt(int value) {
+        char digits[12];
+        put(digits, formatInt(value, digits));
+    }
+
+    // Left-aligned column: truncated to maxLength, then padded to width
+    void putColumn(const string& text, size_t width, size_t maxLength) {
+        size_t length = min(text.size(), maxLength);
+        put(text.data(), length);
+        putRepeated(' ', width > length ? width - length : 0);
+    }
+
+    void putColumn(int value, size_t width) {
+        char digits[12];
+        size_t length = formatInt(value, digits);
+        put(digits, length);
+        putRepeated(' ', width > length ? width - length : 0);
+    }
+
+    void putRepeated(char c, size_t count) {
+        while (count-- > 0) {
+            put(c);
+        }
+    }
+
+    void putCsvField(const string& text) {
+        if (text.find_first_of(",\"\r\n") == string::npos) {
+            putStable(text);
+            return;
+        }
+        put('"');
+        for (char c : text) {
+            if (c == '"') {
+                put('"');
+            }
+            put(c);
+        }
+        put('"');
+    }
+
+    void putJsonString(const string& text) {
+        put('"');
+        for (char c : text) {
+            switch (c) {
+                case '"': put("\\\"", 2); break;
+                case '\\': put("\\\\", 2); break;
+                case '\n': put("\\n", 2); break;
+                case '\r': put("\\r", 2); break;
+                case '\t': put("\\t", 2); break;
+                default:
+                    if ((unsigned char)c < 0x20) {
+                        static const char hex[] = "0123456789abcdef";
+                        char escaped[6] = {'\\', 'u', '0', '0', hex[(c >> 4) & 0xF], hex[c & 0xF]};
+                        put(escaped, 6);
+                    } else {
+                        put(c);
+                    }
+            }
+        }
+        put('"');
+    }
+
+    void flush() {
+        closeSegment();
+        writeIovs();
+        arenaUsed = 0;
+        segmentStart = 0;
+    }
+
+private:
+    static const size_t ARENA_SIZE = 256 * 1024;
+    static const size_t ZERO_COPY_THRESHOLD = 512;
+    static const int MAX_IOV = 64;
+
+    // Hands the queued vectors to the kernel. The arena is left alone, so
+    // segments still being filled stay valid.
+    void writeIovs() {
+        int index = 0;
+        while (index < iovCount && !failed) {
+            ssize_t written = writev(fd, &iov[index], iovCount - index);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                failed = true;
+                break;
+            }
+            // Skip fully written vectors, then trim a partially written one
+            while (index < iovCount && (size_t)written >= iov[index].iov_len) {
+                written -= iov[index].iov_len;
+                index++;
+            }
+            if (index < iovCount) {
+                iov[index].iov_base = (char*)iov[index].iov_base + written;
+                iov[index].iov_len -= written;
+            }
+        }
+        iovCount = 0;
+    }
+
+    // Writes the decimal form of value into out, returns its length
+    static size_t formatInt(int value, char* out) {
+        char reversed[12];
+        size_t n = 0;
+        unsigned int v = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+        do {
+            reversed[n++] = (char)('0' + v % 10);
+            v /= 10;
+        } while (v > 0);
+        size_t length = 0;
+        if (value < 0) {
+            out[length++] = '-';
+        }
+        while (n > 0) {
+            out[length++] = reversed[--n];
+        }
+        return length;
+    }
+
+    void closeSegment() {
+        if (arenaUsed > segmentStart) {
+            size_t start = segmentStart;
+            segmentStart = arenaUsed;
+            pushIov(&arena[start], arenaUsed - start);
+        }
+    }
+
+    void pushIov(const void* data, size_t length) {
+        if (iovCount == MAX_IOV) {
+            writeIovs();
+        }
+        iov[iovCount].iov_base = const_cast<void*>(data);
+        iov[iovCount].iov_len = length;
+        iovCount++;
+    }
+
+    int fd;
+    vector<char> arena;
+    size_t arenaUsed;
+    size_t segmentStart;
+    iovec iov[MAX_IOV];
+    int iovCount;
+    bool failed;
+};
+
+// Function to write the catalog table header
+void writeTableHeader(CatalogWriter& out) {
+    out.putColumn("TITLE", 25, 25);
+    out.putColumn("AUTHOR", 20, 20);
+    out.putColumn("ISBN", 15, 15);
+    out.putColumn("GENRE", 15, 15);
+    out.putColumn("YEAR", 8, 8);
+    out.putColumn("STATUS", 12, 12);
+    out.put('\n');
+}
+
+// Function to write one catalog table row
+void writeTableRow(CatalogWriter& out, const Book& book) {
+    out.putColumn(book.title, 25, 24);
+    out.putColumn(book.author, 20, 19);
+    out.putColumn(book.ISBN, 15, 15);
+    out.putColumn(book.genre, 15, 14);
+    out.putColumn(book.year, 8);
+    out.putColumn(book.checkedOut ? "Checked Out" : "Available", 12, 12);
+    out.put('\n');
+}
+
+// Function to write one catalog row as CSV
+void writeCsvRow(CatalogWriter& out, const Book& book) {
+    out.putCsvField(book.title);
+    out.put(',');
+    out.putCsvField(book.author);
+    out.put(',');
+    out.putCsvField(book.ISBN);
+    out.put(',');
+    out.putCsvField(book.genre);
+    out.put(',');
+    out.putInt(book.year);
+    out.put(',');
+    out.put(book.checkedOut ? "true" : "false");
+    out.put('\n');
+}
+
+// Function to write one catalog row as a JSON Lines record
+void writeJsonRow(CatalogWriter& out, const Book& book) {
+    out.put("{\"title\":", 9);
+    out.putJsonString(book.title);
+    out.put(",\"author\":", 10);
+    out.putJsonString(book.author);
+    out.put(",\"ISBN\":", 8);
+    out.putJsonString(book.ISBN);
+    out.put(",\"genre\":", 9);
+    out.putJsonString(book.genre);
+    out.put(",\"year\":", 8);
+    out.putInt(book.year);
+    out.put(book.checkedOut ? ",\"checkedOut\":true}\n" : ",\"checkedOut\":false}\n");
+}
+
+// Function to display all books, one page at a time
 void displayAllBooks(const vector<Book>& library) {
     if (library.empty()) {
         cout << "\nNo books in the library." << endl;
         return;
     }
     
-    cout << "\n" << string(80, '=') << endl;
-    cout << "LIBRARY CATALOG" << endl;
-    cout << string(80, '=') << endl;
-    cout << left << setw(25) << "TITLE" 
-         << setw(20) << "AUTHOR" 
-         << setw(15) << "ISBN" 
-         << setw(15) << "GENRE" 
-         << setw(8) << "YEAR" 
-         << setw(12) << "STATUS" << endl;
-    cout << string(80, '-') << endl;
+    const size_t pageSize = 20;
+    size_t pageCount = (library.size() + pageSize - 1) / pageSize;
+    cout.flush();
+    CatalogWriter out(STDOUT_FILENO);
     
-    for (const Book& book : library) {
-        cout << left << setw(25) << book.title.substr(0, 24)
-             << setw(20) << book.author.substr(0, 19)
-             << setw(15) << book.ISBN
-             << setw(15) << book.genre.substr(0, 14)
-             << setw(8) << book.year
-             << setw(12) << (book.checkedOut ? "Checked Out" : "Available") << endl;
-    }
-    cout << string(80, '=') << endl;
+    for (size_t page = 0; page < pageCount; page++) {
+        out.put('\n');
+        out.putRepeated('=', 80);
+        out.put("\nLIBRARY CATALOG\n");
+        out.putRepeated('=', 80);
+        out.put('\n');
+        writeTableHeader(out);
+        out.putRepeated('-', 80);
+        out.put('\n');
+        
+        // Only the rows of the visible page are formatted
+        size_t end = min(library.size(), (page + 1) * pageSize);
+        for (size_t i = page * pageSize; i < end; i++) {
+            writeTableRow(out, library[i]);
+        }
+        out.putRepeated('=', 80);
+        out.put('\n');
+        
+        if (page + 1 == pageCount) {
+            break;
+        }
+        out.put("Page ");
+        out.putInt((int)page + 1);
+        out.put(" of ");
+        out.putInt((int)pageCount);
+        out.put(" - press Enter for the next page or q to stop: ");
+        out.flush();
+        
+        string answer;
+        if (!getline(cin, answer) || answer == "q" || answer == "Q") {
+            break;
+        }
+    }
+}
+
+// Function to export the catalog as CSV, JSON Lines or an aligned table
+void exportCatalog(const vector<Book>& library) {
+    string format;
+    string fileName;
+    
+    cout << "\n--- Export Catalog ---" << endl;
+    cout << "Enter format (csv, jsonl, table): ";
+    clearInputBuffer();
+    getline(cin, format);
+    if (format != "csv" && format != "jsonl" && format != "table") {
+        cout << "Error: Unknown export format." << endl;
+        return;
+    }
+    
+    cout << "Enter output file name (leave empty to print to the screen): ";
+    getline(cin, fileName);
+    
+    FILE* file = fileName.empty() ? nullptr : fopen(fileName.c_str(), "wb");
+    if (!fileName.empty() && !file) {
+        cout << "Error: Could not open '" << fileName << "' for writing." << endl;
+        return;
+    }
+    
+    cout.flush();
+    bool ok;
+    {
+        CatalogWriter out(file ? fileno(file) : STDOUT_FILENO);
+        if (format == "csv") {
+            out.put("title,author,ISBN,genre,year,checkedOut\n");
+            for (const Book& book : library) {
+                writeCsvRow(out, book);
+            }
+        } else if (format == "jsonl") {
+            for (const Book& book : library) {
+                writeJsonRow(out, book);
+            }
+        } else {
+            writeTableHeader(out);
+            for (const Book& book : library) {
+                writeTableRow(out, book);
+            }
+        }
+        out.flush();
+        ok = out.good();
+    }
+    
+    if (file) {
+        fclose(file);
+        if (ok) {
+            cout << "Exported " << library.size() << " books to " << fileName << "." << endl;
+        }
+    }
+    if (!ok) {
+        cout << "Error: Failed to write the export." << endl;
+    }
 }
 
 // Function to search for books
@@ -95,26 +647,19 @@ void searchBooks(const vector<Book>& library, const string& query) {
     
     cout << "\nSearch Results (" << results.size() << " found):" << endl;
     cout << string(80, '-') << endl;
-    cout << left << setw(25) << "TITLE" 
-         << setw(20) << "AUTHOR" 
-         << setw(15) << "ISBN" 
-         << setw(15) << "GENRE" 
-         << setw(8) << "YEAR" 
-         << setw(12) << "STATUS" << endl;
-    cout << string(80, '-') << endl;
+    cout.flush();
     
+    CatalogWriter out(STDOUT_FILENO);
+    writeTableHeader(out);
+    out.putRepeated('-', 80);
+    out.put('\n');
     for (const Book& book : results) {
-        cout << left << setw(25) << book.title.substr(0, 24)
-             << setw(20) << book.author.substr(0, 19)
-             << setw(15) << book.ISBN
-             << setw(15) << book.genre.substr(0, 14)
-             << setw(8) << book.year
-             << setw(12) << (book.checkedOut ? "Checked Out" : "Available") << endl;
+        writeTableRow(out, book);
     }
 }
 
 // Function to add a new book
-void addBook(vector<Book>& library) {
+void addBook(vector<Book>& library, IsbnFilter& isbns) {
     Book newBook;
     
     cout << "\n--- Add New Book ---" << endl;
@@ -141,12 +686,15 @@ void addBook(vector<Book>& library) {
         return;
     }
     
-    // Check if ISBN already exists
-    for (const Book& book : library) {
-        if (book.ISBN == newBook.ISBN) {
-            cout << "Error: A book with this ISBN already exists." << endl;
-            return;
+    // Check if ISBN already exists; the filter rules out most new ones
+    if (isbns.mightContain(newBook.ISBN)) {
+        for (const Book& book : library) {
+            if (book.ISBN == newBook.ISBN) {
+                cout << "Error: A book with this ISBN already exists." << endl;
+                return;
+            }
         }
+        isbns.recordFalsePositive();
     }
     
     cout << "Enter genre: ";
@@ -165,11 +713,15 @@ void addBook(vector<Book>& library) {
     
     newBook.checkedOut = false;
     library.push_back(newBook);
+    isbns.insert(newBook.ISBN);
+    if (isbns.needsRebuild()) {
+        isbns.rebuild(library);
+    }
     cout << "\nBook added successfully!" << endl;
 }
 
 // Function to remove a book
-void removeBook(vector<Book>& library) {
+void removeBook(vector<Book>& library, IsbnFilter& isbns) {
     if (library.empty()) {
         cout << "\nNo books in the library to remove." << endl;
         return;
@@ -192,6 +744,7 @@ void removeBook(vector<Book>& library) {
             char confirm;
             cin >> confirm;
             if (confirm == 'y' || confirm == 'Y') {
+                isbns.remove(it->ISBN);
                 library.erase(it);
                 cout << "Book removed successfully!" << endl;
             } else {
@@ -204,13 +757,14 @@ void removeBook(vector<Book>& library) {
 }
 
 // Function to checkout a book
-void checkoutBook(vector<Book>& library, const string& ISBN) {
+void checkoutBook(vector<Book>& library, const string& ISBN, const string& borrower, AuditLog& audit) {
     for (Book& book : library) {
         if (book.ISBN == ISBN) {
             if (book.checkedOut) {
                 cout << "Error: This book is already checked out." << endl;
             } else {
                 book.checkedOut = true;
+                audit.record("checkout", ISBN, borrower);
                 cout << "Success: '" << book.title << "' has been checked out successfully!" << endl;
             }
             return;
@@ -220,11 +774,12 @@ void checkoutBook(vector<Book>& library, const string& ISBN) {
 }
 
 // Function to return a book
-void returnBook(vector<Book>& library, const string& ISBN) {
+void returnBook(vector<Book>& library, const string& ISBN, AuditLog& audit) {
     for (Book& book : library) {
         if (book.ISBN == ISBN) {
             if (book.checkedOut) {
                 book.checkedOut = false;
+                audit.record("return", ISBN, "");
                 cout << "Success: '" << book.title << "' has been returned successfully!" << endl;
             } else {
                 cout << "Error: This book is not checked out." << endl;
@@ -236,7 +791,7 @@ void returnBook(vector<Book>& library, const string& ISBN) {
 }
 
 // Function to display library statistics
-void displayStatistics(const vector<Book>& library) {
+void displayStatistics(const vector<Book>& library, const IsbnFilter& isbns) {
     if (library.empty()) {
         cout << "\nNo books in the library." << endl;
         return;
@@ -260,10 +815,15 @@ void displayStatistics(const vector<Book>& library) {
     cout << "Checked Out Books: " << checkedOutBooks << endl;
     cout << "Availability Rate: " << fixed << setprecision(1) 
          << (double)availableBooks / totalBooks * 100 << "%" << endl;
+    cout << "Duplicate Checks: " << isbns.lookupCount() << " ("
+         << isbns.falsePositiveCount() << " false positives, "
+         << setprecision(2) << isbns.observedFalsePositiveRate() * 100 << "% observed, "
+         << isbns.expectedFalsePositiveRate() * 100 << "% expected)" << endl;
 }
 
 int main() {
     vector<Book> library;
+    AuditLog audit("library_audit.log");
     
     // Initialize with sample data
     library.push_back({"The Great Gatsby", "F. Scott Fitzgerald", "9780743273565", false, "Fiction", 1925});
@@ -273,6 +833,9 @@ int main() {
     library.push_back({"The Catcher in the Rye", "J.D. Salinger", "9780316769174", true, "Fiction", 1951});
     library.push_back({"Introduction to Algorithms", "Thomas H. Cormen", "9780262033848", false, "Computer Science", 2009});
     library.push_back({"Clean Code", "Robert C. Martin", "9780132350884", false, "Programming", 2008});
+    
+    IsbnFilter isbns;
+    isbns.rebuild(library);
 
     cout << "===============================================" << endl;
     cout << "    WELCOME TO LIBRARY MANAGEMENT SYSTEM" << endl;
@@ -289,9 +852,10 @@ int main() {
         cout << "5. Checkout Book" << endl;
         cout << "6. Return Book" << endl;
         cout << "7. Library Statistics" << endl;
-        cout << "8. Exit" << endl;
+        cout << "8. Export Catalog" << endl;
+        cout << "9. Exit" << endl;
         cout << string(50, '-') << endl;
-        cout << "Enter your choice (1-8): ";
+        cout << "Enter your choice (1-9): ";
 
         int choice;
         cin >> choice;
@@ -305,6 +869,7 @@ int main() {
 
         switch (choice) {
             case 1: {
+                clearInputBuffer();
                 displayAllBooks(library);
                 break;
             }
@@ -321,11 +886,11 @@ int main() {
                 break;
             }
             case 3: {
-                addBook(library);
+                addBook(library, isbns);
                 break;
             }
             case 4: {
-                removeBook(library);
+                removeBook(library, isbns);
                 break;
             }
             case 5: {
@@ -337,7 +902,14 @@ int main() {
                     cout << "Error: ISBN cannot be empty." << endl;
                     break;
                 }
-                checkoutBook(library, ISBN);
+                string borrower;
+                cout << "Enter borrower name: ";
+                getline(cin, borrower);
+                if (borrower.empty()) {
+                    cout << "Error: Borrower name cannot be empty." << endl;
+                    break;
+                }
+                checkoutBook(library, ISBN, borrower, audit);
                 break;
             }
             case 6: {
@@ -349,20 +921,24 @@ int main() {
                     cout << "Error: ISBN cannot be empty." << endl;
                     break;
                 }
-                returnBook(library, ISBN);
+                returnBook(library, ISBN, audit);
                 break;
             }
             case 7: {
-                displayStatistics(library);
+                displayStatistics(library, isbns);
                 break;
             }
             case 8: {
+                exportCatalog(library);
+                break;
+            }
+            case 9: {
                 cout << "\nThank you for using the Library Management System!" << endl;
                 cout << "Goodbye!" << endl;
                 return 0;
             }
             default: {
-                cout << "\nError: Invalid choice. Please enter a number between 1 and 8." << endl;
+                cout << "\nError: Invalid choice. Please enter a number between 1 and 9." << endl;
                 break;
             }
         }